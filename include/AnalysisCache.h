@@ -0,0 +1,84 @@
+#ifndef ANALYSIS_CACHE_H
+#define ANALYSIS_CACHE_H
+
+#include "Analyzer.h"
+#include "Sarif.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <array>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+using namespace llvm;
+
+/// Hashes functions by structure: opcodes, types, operands, predicates and
+/// debug locations, with values numbered locally so that unrelated changes
+/// elsewhere in the module do not affect the result. The hash of a function
+/// also covers the hashes of its direct callees, so it changes whenever
+/// anything reachable from it changes.
+class StructuralHasher {
+public:
+  using Hash = std::array<uint8_t, 16>;
+
+  /// Merkle hash of F and everything it calls.
+  Hash getHash(Function &F);
+
+private:
+  std::unordered_map<Function *, Hash> Hashes;
+  std::unordered_map<Function *, bool> InProgress;
+
+  void hashBody(Function &F, MD5 &Hasher);
+};
+
+/// Findings of previous runs, keyed by the structural hash of the call graph
+/// below main together with the analyzer options. The file is read through a
+/// memory map and entries are decoded only when looked up.
+///
+/// File layout, little endian:
+///   "ANCACHE" '\0', u32 version, u32 entry count, then per entry
+///   16-byte key, u32 report count and per report
+///   i32 rule index, str rule id, u32 trace length, (str file, u32 line)...
+/// where str is a u32 length followed by the bytes.
+class AnalysisCache {
+public:
+  using Key = StructuralHasher::Hash;
+
+  /// Load a cache file. A missing file gives an empty cache; a corrupt one is
+  /// ignored with a warning.
+  bool load(const std::string &Path);
+
+  /// Write the old and new entries to Path, replacing it atomically.
+  bool save(const std::string &Path);
+
+  static Key computeKey(Module &M, const AnalyzerOptions &Options);
+
+  bool lookup(const Key &K, std::vector<BugReport> &Reports);
+  void insert(const Key &K, const std::vector<BugReport> &Reports);
+
+  /// Return the cached findings for M or analyze it and remember the result.
+  /// OnReport receives each finding as in SimplePass::findBugs.
+  std::vector<BugReport> findBugs(Module &M, const AnalyzerOptions &Options = {},
+                                  const std::function<void(const BugReport &)> &OnReport = nullptr);
+
+  size_t getHits() const {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Hits;
+  }
+  size_t getMisses() const {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Misses;
+  }
+
+private:
+  std::unique_ptr<MemoryBuffer> Buffer;
+  /// Encoded entries of the loaded file, pointing into Buffer.
+  std::map<Key, StringRef> Stored;
+  std::map<Key, std::vector<BugReport>> Added;
+  mutable std::mutex Mutex;
+  size_t Hits = 0;
+  size_t Misses = 0;
+};
+
+#endif // ANALYSIS_CACHE_H
@@ -4,7 +4,11 @@
 #include "MLChecker.h"
 #include "UAFChecker.h"
 #include "BOFChecker.h"
-#include "llvm/Analysis/CallGraph.h"
+#include "ClonedModule.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <queue>
 
 namespace llvm {
@@ -34,20 +38,122 @@ public:
   }
 };
 
+struct AnalyzerOptions {
+  bool mlCheck = true;
+  bool uafCheck = true;
+  bool bofCheck = true;
+  // Number of threads building FuncInfos. The checkers always run on the
+  // calling thread since BOFChecker renames values.
+  unsigned threads = 1;
+  // Number of instructions whose graphs may stay resident. Functions are then
+  // processed bottom-up on one thread and the graphs of the least recently
+  // used ones are released and rebuilt on demand. 0 keeps every graph.
+  size_t graphBudget = 0;
+  // When set, only the functions reached from main for which it returns true,
+  // the callers through which main reaches them and the functions they pass
+  // pointers to get a FuncInfo and are checked. Calls into other functions
+  // are not followed. Called once per reached function, after its body is
+  // materialized.
+  std::function<bool(const Function &)> isChanged;
+  // Only functions that call malloc, free, memcpy, strcpy, snprintf or scanf
+  // or that use arrays, the callers through which main reaches them and the
+  // functions they pass pointers to get a FuncInfo. A module without such
+  // functions is not analyzed at all.
+  bool prescreen = false;
+  // Build the graphs of each function only over the values connected to its
+  // calls, comparisons, arrays, arguments and returns. The flow graph steps
+  // over the instructions left out.
+  bool slice = false;
+  // Inline calls to non-recursive functions of at most this many
+  // instructions into a copy of the module, so that the checkers do not
+  // descend into small helpers at every call. Reported values are those of
+  // the original module. 0 turns inlining off.
+  size_t inlineThreshold = 0;
+  // Supplies the FuncInfo of a function instead of building it, e.g. from a
+  // FunctionAnalysisManager that caches them between passes. Called on the
+  // calling thread only. Not used with graphBudget or inlineThreshold,
+  // whose graphs differ from those of the module's own functions.
+  std::function<std::shared_ptr<FuncInfo>(Function &)> funcInfoProvider;
+  // Polled before each FuncInfo and each checker, possibly from several
+  // threads. Once it returns true the analysis stops and reports nothing.
+  std::function<bool()> isCancelled;
+  // Called with a stage name ("graphs", "checks") and the number of steps
+  // done out of the total. Calls are serialized but may come from any of the
+  // threads building FuncInfos.
+  std::function<void(const char *, size_t, size_t)> progress;
+  // Remove debug intrinsics and metadata from the module once the functions
+  // to analyze are materialized, before any FuncInfo is built. Reports then
+  // need the locations recorded by onMaterialized.
+  bool stripDebugInfo = false;
+  // Called with the module when every function to analyze is materialized,
+  // before any FuncInfo is built.
+  std::function<void(Module &)> onMaterialized;
+  // Seconds the whole analysis may take, 0 for no limit. Graphs not built and
+  // queries not finished in time are given up, and checkers not yet started
+  // are skipped; the findings made so far are still reported.
+  double timeBudget = 0;
+  // When the time budget starts counting, e.g. when a daemon received the
+  // request, before parsing. Unset, it starts with the Analyzer.
+  std::optional<std::chrono::steady_clock::time_point> budgetStart;
+  // Nodes and edges a single checker query may visit, 0 for no limit.
+  size_t queryNodeBudget = 0;
+  size_t queryEdgeBudget = 0;
+  // Called on the calling thread with a description of each part of the
+  // analysis that a budget cut short.
+  std::function<void(const std::string &)> onTruncated;
+};
+
 class Analyzer {
 private:
   Module *module;
+  AnalyzerOptions options;
   Function *mainFunc;
-  std::unique_ptr<CallGraph> callGraph;
   std::vector<Function *> funcQueue;
+  // The copy analyzed instead of module when inlining.
+  std::unique_ptr<ClonedModule> clone;
 
+  // Module order of every function, used to keep results independent of
+  // pointer values.
+  std::unordered_map<Function *, size_t> funcOrdinals;
+  // Declared before funcInfos, which unregister from it when destroyed.
+  std::unique_ptr<GraphBudget> graphBudget;
   std::unordered_map<Function *, std::shared_ptr<FuncInfo>> funcInfos;
 
   std::unique_ptr<BugTrace> bug;
+  // Whether the malloced objects know their free calls, which the memory
+  // leak check records as it goes and the use-after-free check starts from.
+  bool freesMatched = false;
+
+  std::atomic<bool> cancelled{false};
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+  std::mutex progressMutex;
 
+  bool Materialize(Function *function);
   void AnalyzeFunctions();
+  void RestrictToCallersOf(const std::function<bool(Function *)> &isSeed,
+                           const std::unordered_map<Function *, std::vector<Function *>> &callers,
+                           const std::function<bool(CallBase *)> &keepCallee = nullptr);
+  static bool HasRelevantOperations(Function *function);
+  static bool PassesPointer(CallBase *call);
+  void CloneFunctions();
+  std::pair<Value *, Instruction *> MapToOriginal(const std::pair<Value *, Instruction *> &trace) const;
+  void ConstructFuncInfos();
+  void ConstructFuncInfosBottomUp();
+  std::vector<Function *> GetBottomUpOrder() const;
+  QueryBudget GetQueryBudget() const;
+  bool StartCheck(const char *name);
+  void ReportTruncated(const std::string &what);
+  void FinishCheck(const char *name, const Checker &checker);
 public:
-  Analyzer(Module &m);
+  Analyzer(Module &m, const AnalyzerOptions &opts = {});
+
+  const AnalyzerOptions &GetOptions() const;
+  bool IsCancelled();
+  bool OutOfTime() const;
+  void ReportProgress(const char *stage, size_t done, size_t total);
+
+  size_t GetFunctionOrdinal(Function *function) const;
+  const std::vector<Function *> &GetAnalyzedFunctions() const;
 
   std::shared_ptr<BugTrace> MLCheck();
   std::shared_ptr<BugTrace> UAFCheck();
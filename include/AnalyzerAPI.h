@@ -0,0 +1,65 @@
+#ifndef ANALYZER_API_H
+#define ANALYZER_API_H
+
+#include "Analyzer.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/// Library entry points for embedding the analyzer in another process. The
+/// findings come back as values; nothing is written to disk and no SARIF is
+/// produced.
+
+/// One problem found by a checker.
+struct Finding {
+  struct Location {
+    /// file:// URI of the source file, empty without debug info.
+    std::string File;
+    unsigned Line;
+  };
+
+  /// SARIF rule id, e.g. "memory-leak".
+  std::string RuleId;
+  int RuleIndex;
+  /// Where the problem originates (e.g. the allocation), then where it shows.
+  std::vector<Location> Trace;
+};
+
+struct AnalysisOptions {
+  AnalyzerOptions Analysis;
+  /// Read only the function bodies reachable from main (analyzeBuffer only).
+  bool LazyLoad = false;
+  /// Polled between the steps of the analysis, possibly from several threads.
+  /// Returning true abandons it.
+  std::function<bool()> IsCancelled;
+  /// Reports the stage ("parse", "graphs", "checks") and the steps done out of
+  /// the total.
+  std::function<void(StringRef Stage, size_t Done, size_t Total)> Progress;
+};
+
+struct AnalysisResult {
+  std::vector<Finding> Findings;
+  /// Set when IsCancelled stopped the analysis; Findings is then empty.
+  bool Cancelled = false;
+  /// Parse errors of analyzeBuffer, or why analyzeModule could not read a
+  /// body of a lazily loaded module.
+  std::string Error;
+  /// Parts of the analysis cut short by the budgets of Options.Analysis
+  /// (timeBudget, queryNodeBudget, queryEdgeBudget). Findings may be missing.
+  std::vector<std::string> Truncated;
+};
+
+/// Analyze a module owned by the caller. The analysis runs on a copy, since
+/// the checkers rename values and debug-lite strips debug info; M itself is
+/// only changed by materializing all of its bodies when it is read lazily.
+/// Use analyzeBuffer with LazyLoad to read only what the analysis needs.
+AnalysisResult analyzeModule(Module &M, const AnalysisOptions &Options = {});
+
+/// Parse bitcode or textual IR from Buffer into a private LLVMContext and
+/// analyze it.
+AnalysisResult analyzeBuffer(MemoryBufferRef Buffer, const AnalysisOptions &Options = {});
+
+#endif // ANALYZER_API_H
@@ -0,0 +1,97 @@
+#ifndef BATCH_DRIVER_H
+#define BATCH_DRIVER_H
+
+#include "AnalysisCache.h"
+#include "FindingsLog.h"
+#include "Sarif.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Outcome of analyzing a single bitcode file.
+struct InputResult {
+  std::string Path;
+  std::vector<BugReport> Reports;
+  std::string Error;
+
+  bool failed() const { return !Error.empty(); }
+};
+
+/// Parse a bitcode or textual IR file into Context. With Lazy set, function
+/// bodies of bitcode files are left unread until the analyzer materializes
+/// the ones reachable from main.
+std::unique_ptr<Module> parseInput(const std::string &Path, LLVMContext &Context,
+                                   std::string &Error, bool Lazy = false);
+
+/// Parse and analyze one bitcode file in a fresh LLVMContext. Findings are
+/// taken from Cache when the code reachable from main is unchanged.
+InputResult analyzeFile(const std::string &Path, bool Lazy = false,
+                        AnalysisCache *Cache = nullptr, const AnalyzerOptions &Analysis = {});
+
+/// Runs the analyzer over many bitcode files on a pool of worker threads.
+/// Every worker parses into its own LLVMContext, so no LLVM state is shared
+/// between threads. Results are emitted in input order.
+class BatchDriver {
+public:
+  struct Options {
+    unsigned Threads = 1;
+    /// Write one report per input into this directory.
+    std::string OutputDir;
+    /// Write a single report with the results of all inputs.
+    std::string MergedOutput;
+    /// Write the results of all inputs to this binary findings log.
+    std::string FindingsLog;
+    /// Overlap parsing, analysis and report writing in separate stages
+    /// instead of running whole inputs per thread.
+    bool Pipeline = false;
+    /// Capacity of the queues between pipeline stages.
+    unsigned QueueDepth = 4;
+    /// Materialize only the functions reachable from main.
+    bool LazyLoad = false;
+    /// Reuse and update the findings stored in this cache file.
+    std::string CachePath;
+    /// Write reports without indentation.
+    bool Compact = false;
+    /// Strip debug info from each module after taking its locations.
+    bool DebugLite = false;
+    /// Build graphs only for functions with relevant operations.
+    bool Prescreen = false;
+    /// Build graphs only over the slice of each function.
+    bool Slice = false;
+    /// Size up to which functions are inlined before analysis, 0 for none.
+    unsigned InlineThreshold = 0;
+  };
+
+  BatchDriver(std::vector<std::string> Inputs, Options Opts);
+
+  /// Returns the number of inputs that could not be analyzed.
+  unsigned run();
+
+  const std::vector<InputResult> &getResults() const { return Results; }
+
+private:
+  std::vector<std::string> Inputs;
+  Options Opts;
+  std::vector<InputResult> Results;
+  std::vector<std::string> ReportPaths;
+  std::atomic<size_t> NextInput{0};
+  std::unique_ptr<AnalysisCache> Cache;
+  std::unique_ptr<SarifWriter> MergedWriter;
+  std::unique_ptr<FindingsLogWriter> LogWriter;
+  std::mutex MergedMutex;
+  /// Inputs whose results are final, and the first one not yet merged.
+  std::vector<bool> Finished;
+  size_t NextMerged = 0;
+
+  void worker();
+  void runPipeline(unsigned AnalyzeThreads);
+  void writeReport(size_t Index);
+  void appendMergedReport(size_t Index);
+  void assignReportPaths();
+  AnalyzerOptions getAnalyzerOptions() const;
+};
+
+#endif // BATCH_DRIVER_H
@@ -0,0 +1,54 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/// Blocking FIFO with a fixed capacity used to connect pipeline stages.
+/// Producers block while the queue is full, consumers while it is empty.
+/// After close(), pop() drains the remaining items and then fails.
+template <typename T> class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t Capacity) : Capacity(Capacity ? Capacity : 1) {}
+
+  bool push(T Item) {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    NotFull.wait(Lock, [this] { return Closed || Items.size() < Capacity; });
+    if (Closed) {
+      return false;
+    }
+    Items.push_back(std::move(Item));
+    NotEmpty.notify_one();
+    return true;
+  }
+
+  bool pop(T &Item) {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    NotEmpty.wait(Lock, [this] { return Closed || !Items.empty(); });
+    if (Items.empty()) {
+      return false;
+    }
+    Item = std::move(Items.front());
+    Items.pop_front();
+    NotFull.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Closed = true;
+    NotFull.notify_all();
+    NotEmpty.notify_all();
+  }
+
+private:
+  size_t Capacity;
+  bool Closed = false;
+  std::deque<T> Items;
+  std::mutex Mutex;
+  std::condition_variable NotFull;
+  std::condition_variable NotEmpty;
+};
+
+#endif // BOUNDED_QUEUE_H
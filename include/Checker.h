@@ -2,9 +2,26 @@
 #define ANALYZER_SRC_CHECKER_H
 
 #include "FuncInfo.h"
+#include "llvm/ADT/StringSet.h"
+#include <chrono>
+#include <map>
 
 namespace llvm {
 
+// Limits on the queries of one checker. A query that visits more nodes or
+// edges than allowed, or runs past the deadline, stops and finds nothing.
+struct QueryBudget {
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+  // Per query, 0 for no limit.
+  size_t nodes = 0;
+  size_t edges = 0;
+
+  bool OutOfTime() const {
+    return deadline != std::chrono::steady_clock::time_point::max() &&
+           std::chrono::steady_clock::now() >= deadline;
+  }
+};
+
 struct DFSOptions {
   std::function<bool(Value *)> terminationCondition = nullptr;
   std::function<bool(Value *)> continueCondition = nullptr;
@@ -18,7 +35,7 @@ struct DFSContext {
 
 struct DFSResult {
   bool status = false;
-  std::unordered_map<std::string, bool> funcsStats = {};
+  std::map<std::string, bool> funcsStats = {};
   std::vector<Value *> path;
   void combine(const DFSResult &other, const std::string& funcName) {
     path.insert(path.end(), other.path.begin(), other.path.end());
@@ -29,31 +46,42 @@ struct DFSResult {
 
 class Checker {
 private:
-  std::vector<std::string> libraryCalls = {CallInstruction::Memcpy,
-                                           CallInstruction::Strlen,
-                                           CallInstruction::Scanf,
-                                           CallInstruction::Malloc,
-                                           CallInstruction::Free,
-                                           CallInstruction::Time,
-                                           CallInstruction::Srand,
-                                           CallInstruction::Rand,
-                                           CallInstruction::Printf,
-                                           CallInstruction::Snprintf,
-                                           CallInstruction::Memset,
-                                           CallInstruction::Strcpy,
-                                           CallInstruction::Fopen,
-                                           CallInstruction::Fprint,
-  };
+  // Names of the library calls the traversal does not descend into. The set
+  // is built once per process and shared by all checkers.
+  static const StringSet<> &GetLibraryCalls();
 
 protected:
   std::unordered_map<Function *, std::shared_ptr<FuncInfo>> funcInfos;
   bool IsLibraryFunction(Value *inst);
+  // False for functions left out of the analysis, e.g. outside a diff scope.
+  bool HasFuncInfo(Function *function) const;
   std::vector<Value*> tmpPath;
 
+  QueryBudget budget;
+  // State of the outermost query in progress; queries started from the
+  // callbacks of another one share its budget.
+  size_t queryDepth = 0;
+  size_t queryNodes = 0;
+  size_t queryEdges = 0;
+  bool queryStopped = false;
+  size_t stoppedQueries = 0;
+  std::string stopReason;
+
+  void BeginQuery();
+  void EndQuery();
+  // Charge a visited node and its outgoing edges to the current query. False
+  // once the query is out of budget.
+  bool ChargeQuery(size_t edges);
+
 public:
 
   Checker(const std::unordered_map<Function *, std::shared_ptr<FuncInfo>> &funcInfos);
 
+  void SetBudget(const QueryBudget &queryBudget);
+  // Number of queries cut short by the budget, and why the last one was.
+  size_t GetStoppedQueries() const;
+  const std::string &GetStopReason() const;
+
   // TODO: later change the name
   DFSResult DFSTraverse(Function *function, const DFSContext &context,
                         std::unordered_set<Value *> &visitedNodes);
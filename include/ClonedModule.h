@@ -0,0 +1,53 @@
+#ifndef ANALYZER_SRC_CLONEDMODULE_H
+#define ANALYZER_SRC_CLONEDMODULE_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+
+// A copy of some functions of a module that passes may rewrite freely. The
+// other functions are only declared in the copy. Values of the copy map back
+// to the values of the original they stand for, so that reports still point
+// at the original.
+class ClonedModule {
+private:
+  // A value of the original, and what its copy became: handle stays null once
+  // the copy is deleted, and replacement follows it when it is replaced.
+  struct Handle {
+    Value *original;
+    WeakVH handle;
+    WeakTrackingVH replacement;
+  };
+
+  std::unique_ptr<Module> clone;
+  ValueToValueMapTy valueMap;
+  std::vector<Handle> handles;
+  std::unordered_map<const Value *, Value *> originals;
+
+  void MapBack();
+public:
+  ClonedModule(const Module &module, const std::vector<Function *> &functions);
+
+  Module &GetModule();
+  Function *GetClone(const Function *original) const;
+
+  // Inline calls to non-recursive functions of at most threshold
+  // instructions. Inlined instructions map back to the instructions of the
+  // callee they were copied from.
+  void InlineSmallFunctions(size_t threshold);
+
+  // The value of the original module that value stands for. Instructions the
+  // passes created stand for the next instruction of their block that maps
+  // back. Null when nothing does.
+  Value *GetOriginal(Value *value) const;
+};
+
+} // namespace llvm
+
+#endif // ANALYZER_SRC_CLONEDMODULE_H
@@ -0,0 +1,65 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "AnalysisCache.h"
+#include "Socket.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/// Protocol between analyzer-client and the daemon, framed by MessageStream.
+///   client -> daemon: ANALYZE (payload: bitcode path), SHUTDOWN
+///   daemon -> client: RESULT <ok|error> (payload: SARIF report or message)
+struct DaemonCommand {
+  static const std::string Analyze;
+  static const std::string Result;
+  static const std::string Shutdown;
+};
+
+/// Serves analysis requests on a socket. The findings cache and the checker
+/// tables stay warm between requests; every request parses into its own
+/// LLVMContext, and connections are handled concurrently. Requests run in the
+/// daemon process itself, so an input that crashes the analysis takes every
+/// open connection down with it; use the supervisor mode of analyzer-batch
+/// for untrusted inputs.
+class AnalysisDaemon {
+public:
+  struct Options {
+    std::string Address;
+    AnalyzerOptions Analysis;
+    bool LazyLoad = false;
+    /// Load the cache from this file at startup and write it back after
+    /// requests that added entries.
+    std::string CachePath;
+    bool Compact = false;
+  };
+
+  explicit AnalysisDaemon(Options Opts) : Opts(std::move(Opts)) {}
+
+  /// Serve until a SHUTDOWN request, then disconnect the remaining clients.
+  /// Returns false if the address cannot be
+  /// bound.
+  bool run();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  Options Opts;
+  AnalysisCache Cache;
+  std::atomic<bool> Stopping{false};
+  std::mutex SaveMutex;
+  size_t SavedMisses = 0;
+
+  void serve(int Fd);
+  std::string analyze(const std::string &Path, Clock::time_point Received, bool &Ok);
+};
+
+/// Ask the daemon at Address to analyze Path. On success Report holds the SARIF
+/// text; otherwise Error describes the failure.
+bool requestAnalysis(StringRef Address, const std::string &Path, std::string &Report,
+                     std::string &Error);
+
+/// Ask the daemon at Address to exit.
+bool requestShutdown(StringRef Address, std::string &Error);
+
+#endif // DAEMON_H
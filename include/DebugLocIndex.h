@@ -0,0 +1,41 @@
+#ifndef DEBUG_LOC_INDEX_H
+#define DEBUG_LOC_INDEX_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Module.h"
+#include <string>
+
+using namespace llvm;
+
+/// Source positions of the values of a module, collected in one walk over its
+/// function bodies so that building the traces of many reports does not scan
+/// functions again. Lines are (unsigned)-1 when unknown, file URIs empty.
+class DebugLocIndex {
+public:
+  /// With RecordLines the line of every located instruction is copied too, so
+  /// that the index still answers after the module's debug info is stripped.
+  explicit DebugLocIndex(const Module &M, bool RecordLines = false);
+
+  const Module &getModule() const { return M; }
+
+  /// Line of an instruction from its DebugLoc, else of the dbg.declare of the
+  /// alloca it is; line of the declaration of a global variable.
+  unsigned getLine(const Value *V) const;
+
+  /// file:// URI of the source file of the first located instruction of F.
+  const std::string &getFileUri(const Function *F) const;
+
+private:
+  const Module &M;
+  /// Addresses described by a dbg.declare, to the line of the first one.
+  DenseMap<const Value *, unsigned> DeclareLines;
+  DenseMap<const Value *, unsigned> GlobalLines;
+  /// Only filled with RecordLines.
+  DenseMap<const Instruction *, unsigned> InstructionLines;
+  DenseMap<const Function *, std::string> FileUris;
+
+  static std::string makeFileUri(const DILocation *Location);
+};
+
+#endif // DEBUG_LOC_INDEX_H
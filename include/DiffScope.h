@@ -0,0 +1,43 @@
+#ifndef DIFF_SCOPE_H
+#define DIFF_SCOPE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Module.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/// Source lines touched by a patch. Functions with an instruction on one of
+/// these lines, found through the debug locations, seed a diff-scoped
+/// analysis (AnalyzerOptions::isChanged).
+class DiffScope {
+public:
+  /// Read the hunks in Path: either a unified diff (e.g. git diff -U0) or
+  /// lines of the form <file>:<line> or <file>:<first>-<last>.
+  bool load(const std::string &Path, std::string &Error);
+
+  /// Whether the materialized function F has a changed line. File names match
+  /// when the path in the debug info ends with the path of the hunk. The
+  /// analysis only asks about the functions it reaches, so the bodies of a
+  /// lazily loaded module are not all read for this.
+  bool isChanged(const Function &F) const;
+
+  size_t getHunkCount() const { return Hunks.size(); }
+
+private:
+  struct Hunk {
+    std::string File;
+    unsigned First;
+    unsigned Last;
+  };
+  std::vector<Hunk> Hunks;
+  /// Hunks of each debug info file seen so far.
+  mutable DenseMap<const DIFile *, std::vector<const Hunk *>> FileHunks;
+
+  bool parseUnifiedDiff(StringRef Text, std::string &Error);
+  bool parseLineList(StringRef Text, std::string &Error);
+};
+
+#endif // DIFF_SCOPE_H
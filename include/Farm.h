@@ -0,0 +1,98 @@
+#ifndef FARM_H
+#define FARM_H
+
+#include "BatchDriver.h"
+#include "Socket.h"
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Protocol between the coordinator and its workers. Every message is framed
+/// by MessageStream.
+///   worker -> coordinator: NEXT, HEARTBEAT, RESULT <job> <ok|error>
+///   coordinator -> worker: JOB <job> <name>=<value>... (payload: bitcode path),
+///                          WAIT, BYE
+/// The name=value arguments of JOB are the analysis options to apply. The
+/// RESULT payload is a SARIF report or an error message.
+struct FarmCommand {
+  static const std::string Next;
+  static const std::string Heartbeat;
+  static const std::string Result;
+  static const std::string Job;
+  static const std::string Wait;
+  static const std::string Bye;
+};
+
+/// Hands out bitcode paths to workers connecting over TCP or a Unix socket and
+/// merges their results in input order. A job whose worker disconnects or
+/// stops sending heartbeats is put back in the queue.
+class Coordinator {
+public:
+  struct Options {
+    std::string Address;
+    unsigned HeartbeatTimeoutSec = 10;
+    /// A job is given up after this many lost workers.
+    unsigned MaxAttempts = 3;
+    /// Merged report of all inputs, none if empty.
+    std::string MergedOutput = "report.sarif";
+    /// Also write the findings of all inputs to this binary findings log.
+    std::string FindingsLog;
+    bool Compact = false;
+    /// Sent to the workers with every job.
+    AnalyzerOptions Analysis;
+    bool LazyLoad = false;
+  };
+
+  Coordinator(std::vector<std::string> Inputs, Options Opts);
+
+  /// Returns the number of inputs that could not be analyzed, or -1 if the
+  /// coordinator could not listen.
+  int run();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  enum class JobStatus { Queued, Running, Done, Failed };
+
+  struct Connection {
+    std::unique_ptr<MessageStream> Stream;
+    long Job = -1;
+    Clock::time_point LastSeen;
+  };
+
+  std::vector<std::string> Inputs;
+  Options Opts;
+  std::deque<size_t> Queue;
+  std::vector<JobStatus> Statuses;
+  std::vector<unsigned> Attempts;
+  std::vector<std::string> Reports;
+  std::vector<Connection> Connections;
+
+  bool isFinished() const;
+  void handle(Connection &C, const Message &Msg);
+  void dropConnection(Connection &C, StringRef Reason);
+  void writeMergedReport();
+};
+
+/// Pulls jobs from a coordinator, analyzes them and streams the reports back.
+/// A background thread sends heartbeats while a job is being analyzed.
+class FarmWorker {
+public:
+  struct Options {
+    std::string Address;
+    unsigned HeartbeatIntervalSec = 2;
+  };
+
+  explicit FarmWorker(Options Opts) : Opts(std::move(Opts)) {}
+
+  /// Returns the number of jobs analyzed, or -1 if the coordinator could not
+  /// be reached.
+  int run();
+
+private:
+  Options Opts;
+};
+
+#endif // FARM_H
@@ -0,0 +1,87 @@
+#ifndef FINDINGS_LOG_H
+#define FINDINGS_LOG_H
+
+#include "Sarif.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/// Binary, append-only log of findings, for batch runs too large to go
+/// through SARIF. A log is a sequence of segments; every segment starts with
+/// a header record and interns its own strings, so logs may simply be
+/// concatenated. All integers are little-endian u32.
+///
+///   header:  kind 0, "ANFL", version
+///   string:  kind 1, id, length, bytes      (defined before first use)
+///   finding: kind 2, input id, rule id, rule index, step count,
+///            step count x (file id, line)
+///
+/// Kinds are one byte. Strings are the input paths, rule ids and file URIs.
+/// Records are not fixed-size: a string record carries its bytes and a
+/// finding its trace, so there is no offset table and a reader walks the log
+/// from the start, one record after the other.
+
+/// A finding read back from a log. The strings point into the log's buffer
+/// and live as long as the reader.
+struct LoggedFinding {
+  StringRef Input;
+  StringRef RuleId;
+  uint32_t RuleIndex = 0;
+  SmallVector<std::pair<StringRef, uint32_t>, 2> Trace;
+
+  BugReport toBugReport() const;
+};
+
+/// Total order used to sort and merge logs: by input, then rule, then trace.
+bool operator<(const LoggedFinding &LHS, const LoggedFinding &RHS);
+bool operator==(const LoggedFinding &LHS, const LoggedFinding &RHS);
+
+class FindingsLogWriter {
+public:
+  /// Create Path ("-" for stdout) and write the segment header.
+  static std::unique_ptr<FindingsLogWriter> create(const std::string &Path, std::string &Error);
+
+  void add(StringRef Input, const BugReport &Report);
+  void add(const LoggedFinding &Finding);
+  /// Write out buffered records.
+  void flush();
+
+private:
+  explicit FindingsLogWriter(std::unique_ptr<raw_fd_ostream> OS);
+
+  std::unique_ptr<raw_fd_ostream> OS;
+  StringMap<uint32_t> Strings;
+
+  uint32_t intern(StringRef Str);
+  void writeU32(uint32_t Value);
+};
+
+class FindingsLogReader {
+public:
+  static std::unique_ptr<FindingsLogReader> open(const std::string &Path, std::string &Error);
+
+  /// Read the next finding. Returns false at the end of the log or on a
+  /// malformed record, which sets the error.
+  bool next(LoggedFinding &Finding);
+  const std::string &getError() const { return Error; }
+
+private:
+  FindingsLogReader(std::unique_ptr<MemoryBuffer> Buffer, std::string Path);
+
+  std::unique_ptr<MemoryBuffer> Buffer;
+  std::string Path;
+  size_t Offset = 0;
+  /// Strings of the current segment, by id.
+  std::vector<StringRef> Strings;
+  std::string Error;
+
+  bool readU32(uint32_t &Value);
+  bool readString(StringRef &Str);
+  bool fail(const Twine &Message);
+};
+
+#endif // FINDINGS_LOG_H
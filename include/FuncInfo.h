@@ -7,7 +7,11 @@
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SetVector.h"
 
+#include <algorithm>
+#include <list>
 #include <unordered_set>
 #include <utility>
 #include <stack>
@@ -99,6 +103,7 @@ public:
   bool isMallocedWithOffset() const;
   void setMallocCall(Instruction *malloc);
   void addFreeCall(Instruction *free);
+  void clearFreeCalls();
   MallocedObject *getMainObj() const;
   Instruction *getMallocCall() const;
   std::vector<Instruction *> getFreeCalls() const;
@@ -108,6 +113,10 @@ public:
 
 bool IsCallWithName(Instruction *inst, const std::string &name);
 
+// The library calls the checkers look at; both prescreens keep the functions
+// that make them.
+bool IsRelevantCall(StringRef name);
+
 struct CallInstruction {
   static const std::string Malloc;
   static const std::string Free;
@@ -155,9 +164,32 @@ enum AnalyzerMap {
   BackwardFlowMap
 };
 
+// Successors are kept in insertion order. Graphs are built by walking the
+// function in instruction order, so iteration never depends on heap addresses.
+using ValueSet = SetVector<Value *>;
+using ValueGraph = std::unordered_map<Value *, ValueSet>;
+
 int64_t CalculateOffsetInBits(GetElementPtrInst *inst);
 Instruction *GetCmpNullOperand(Instruction *icmp);
 
+class FuncInfo;
+
+// Bounds the number of instructions whose graphs are resident at once. The
+// least recently used FuncInfos that are not pinned are released first.
+class GraphBudget {
+private:
+  size_t limit;
+  size_t resident = 0;
+  std::list<FuncInfo *> lru;
+  std::unordered_map<FuncInfo *, std::list<FuncInfo *>::iterator> positions;
+public:
+  explicit GraphBudget(size_t limit);
+
+  void Touch(FuncInfo *info);
+  void Forget(FuncInfo *info);
+  size_t GetResident() const;
+};
+
 class FuncInfo {
 private:
   Function *function = {};
@@ -165,15 +197,34 @@ private:
 
   std::unordered_map<std::string, std::vector<Instruction *>> callInstructions;
 
-  std::unordered_map<Value *, std::unordered_set<Value *>> forwardDependencyMap;
-  std::unordered_map<Value *, std::unordered_set<Value *>> backwardDependencyMap;
-  std::unordered_map<Value *, std::unordered_set<Value *>> forwardFlowMap;
-  std::unordered_map<Value *, std::unordered_set<Value *>> backwardFlowMap;
+  ValueGraph forwardDependencyMap;
+  ValueGraph backwardDependencyMap;
+  ValueGraph forwardFlowMap;
+  ValueGraph backwardFlowMap;
+
+  std::unordered_map<BasicBlock *, SetVector<BasicBlock *>> bbCFG;
 
-  std::unordered_map<BasicBlock *, std::unordered_set<BasicBlock *>> bbCFG;
+  // Position of every argument and instruction in module order.
+  std::unordered_map<Value *, size_t> ordinals;
 
   std::shared_ptr<LoopsInfo> loopInfo = {nullptr};
 
+  GraphBudget *budget = nullptr;
+  bool graphsBuilt = false;
+  unsigned pins = 0;
+
+  // With slicing, the dependency graphs only hold the values connected to the
+  // allocations, frees and checker sinks, and the flow graph skips the other
+  // instructions. The slice only lives while the graphs are built.
+  bool slicing = false;
+  std::unordered_set<Value *> slice;
+
+  void NumberValues();
+  void BuildGraphs();
+  void ComputeSlice();
+  bool InSlice(Value *val) const;
+  bool InFlowSlice(Instruction *inst) const;
+  ValueGraph *GetMap(AnalyzerMap mapID);
   void CollectCalls(Instruction *callInst);
 
   void AddEdge(AnalyzerMap mapID, Value *source, Value *destination);
@@ -209,9 +260,25 @@ private:
   void SetLoopScope();
 public:
   FuncInfo() = default;
-  FuncInfo(Function *func);
+  FuncInfo(Function *func, GraphBudget *graphBudget = nullptr, bool sliceGraphs = false);
+  ~FuncInfo();
 
-  std::unordered_map<Value *, std::unordered_set<Value *>> *SelectMap(AnalyzerMap mapID);
+  // Returns the requested graph, rebuilding the graphs first if they were
+  // released.
+  ValueGraph *SelectMap(AnalyzerMap mapID);
+
+  // Frees the dependency and flow graphs. Malloced objects, loop info and the
+  // collected calls stay available as the summary of the function.
+  void Release();
+  bool HasGraphs() const;
+  size_t GetGraphCost() const;
+
+  // A pinned FuncInfo is never released by its budget.
+  void Pin();
+  void Unpin();
+  bool IsPinned() const;
+
+  size_t GetOrdinal(Value *val) const;
 
   MallocedObject *FindSuitableObj(Instruction *base);
 
@@ -221,6 +288,10 @@ public:
 
   std::shared_ptr<LoopsInfo> GetLoopInfo();
   void SetLoopRange(std::pair<int64_t, int64_t> range);
+  // Forget what the checkers recorded, the free calls matched to the malloced
+  // objects and the range of the loop, so that a FuncInfo kept between
+  // analyses is checked afresh.
+  void ResetCheckResults();
 
   void printBBCFG();
 
@@ -235,7 +306,8 @@ public:
                                    const std::function<bool(Instruction *)> &type,
                                    CallDataDepInfo *callInfo = nullptr);
 
-  std::unordered_map<Instruction *, std::shared_ptr<MallocedObject>> mallocedObjs;
+  // Keyed by the malloc call, in instruction order.
+  MapVector<Instruction *, std::shared_ptr<MallocedObject>> mallocedObjs;
 
   std::vector<Instruction *> CollectAllGeps(Instruction *malloc);
 
@@ -248,6 +320,21 @@ public:
   size_t GetArgsNum();
 };
 
+// Keeps a FuncInfo pinned for the lifetime of the guard.
+class FuncInfoPin {
+private:
+  FuncInfo *info;
+public:
+  explicit FuncInfoPin(FuncInfo *funcInfo) : info(funcInfo) {
+    info->Pin();
+  }
+  ~FuncInfoPin() {
+    info->Unpin();
+  }
+  FuncInfoPin(const FuncInfoPin &) = delete;
+  FuncInfoPin &operator=(const FuncInfoPin &) = delete;
+};
+
 } // namespace llvm
 
 #endif // ANALYZER_SRC_FUNCINFO_H
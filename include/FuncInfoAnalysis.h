@@ -0,0 +1,47 @@
+#ifndef ANALYZER_SRC_FUNCINFOANALYSIS_H
+#define ANALYZER_SRC_FUNCINFOANALYSIS_H
+
+#include "FuncInfo.h"
+#include "llvm/IR/PassManager.h"
+
+#include <memory>
+
+namespace llvm {
+
+// The FuncInfo of a function as a new pass manager analysis: its dependency
+// and flow graphs, malloced objects and loops are built once and shared by
+// every pass of a pipeline that asks for them, until a pass changes the
+// function.
+class FuncInfoAnalysis : public AnalysisInfoMixin<FuncInfoAnalysis> {
+private:
+  friend AnalysisInfoMixin<FuncInfoAnalysis>;
+  static AnalysisKey Key;
+
+  bool slice;
+public:
+  class Result {
+  private:
+    std::shared_ptr<FuncInfo> info;
+  public:
+    explicit Result(std::shared_ptr<FuncInfo> funcInfo);
+
+    const std::shared_ptr<FuncInfo> &GetFuncInfo() const;
+
+    // The graphs point at the instructions of the function, so the result
+    // only survives passes that preserve it or all function analyses. What
+    // the checkers record is undone by FuncInfo::ResetCheckResults; the
+    // names BOFChecker gives to values are not part of the graphs.
+    bool invalidate(Function &function, const PreservedAnalyses &preserved,
+                    FunctionAnalysisManager::Invalidator &invalidator);
+  };
+
+  // With sliceGraphs the graphs are built over the slice, as with
+  // AnalyzerOptions::slice.
+  explicit FuncInfoAnalysis(bool sliceGraphs = false);
+
+  Result run(Function &function, FunctionAnalysisManager &manager);
+};
+
+} // namespace llvm
+
+#endif // ANALYZER_SRC_FUNCINFOANALYSIS_H
@@ -28,6 +28,10 @@ public:
 
   MLChecker(const std::unordered_map<Function *, std::shared_ptr<FuncInfo>> &funcInfos);
   std::pair<Value *, Instruction *> Check(Function *function) override;
+
+  // Record on the malloced objects of function the free calls that release
+  // them, as Check does on the way, without looking for leaks.
+  void MatchFreeCalls(Function *function);
 };
 
 } // namespace llvm
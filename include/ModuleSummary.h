@@ -0,0 +1,35 @@
+#ifndef MODULE_SUMMARY_H
+#define MODULE_SUMMARY_H
+
+#include "llvm/IR/Module.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/// What the cross-module pre-screen needs to know about one input file: the
+/// symbols it defines and the direct calls made by each of its functions.
+/// Summaries are small and are kept on disk, so unchanged files need not be
+/// read again to plan the link of a project.
+struct ModuleSummary {
+  struct FunctionEntry {
+    std::string Name;
+    bool Local = false;
+    std::vector<std::string> Callees;
+  };
+
+  std::vector<FunctionEntry> Functions;
+  /// Global variables the module defines for other modules.
+  std::vector<std::string> Variables;
+
+  /// Summarize M. Without WithCalls only the defined symbols are recorded and
+  /// no function body is materialized.
+  static bool compute(Module &M, bool WithCalls, ModuleSummary &Summary, std::string &Error);
+
+  /// Read the summary of the input at Path from Dir, provided it was written
+  /// for the current size and modification time of the input.
+  bool read(const std::string &Dir, const std::string &Path);
+  void write(const std::string &Dir, const std::string &Path) const;
+};
+
+#endif // MODULE_SUMMARY_H
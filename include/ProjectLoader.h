@@ -0,0 +1,69 @@
+#ifndef PROJECT_LOADER_H
+#define PROJECT_LOADER_H
+
+#include "ModuleSummary.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/// Links the bitcode files of a project into one module in memory, so calls
+/// across translation units are analyzed like calls inside one file.
+///
+/// Every input is opened lazily to index the functions it defines. Linking
+/// starts from declarations of the entry points and pulls in, with
+/// Linker::LinkOnlyNeeded, only the definitions that are still undefined in
+/// the linked module, repeating until no index entry resolves a remaining
+/// declaration. Unreachable functions are never materialized.
+///
+/// With the pre-screen, the index is built from per-module summaries instead,
+/// and only functions that can reach an allocation, deallocation, copy or input
+/// call are imported; the bodies of the others are dropped before linking.
+class ProjectLoader {
+public:
+  struct Options {
+    std::vector<std::string> EntryPoints = {"main"};
+    bool Prescreen = false;
+    /// Keep the summaries used by the pre-screen here between runs.
+    std::string SummaryDir;
+  };
+
+  explicit ProjectLoader(Options Opts) : Opts(std::move(Opts)) {}
+  ProjectLoader() = default;
+
+  /// Expand Path into input files: every .bc and .ll file below a directory,
+  /// or the lines of a file list.
+  static bool collectInputs(const std::string &Path, std::vector<std::string> &Inputs,
+                            std::string &Error);
+
+  std::unique_ptr<Module> load(const std::vector<std::string> &Inputs, LLVMContext &Context,
+                               std::string &Error);
+
+  /// Number of input files that contributed definitions to the last load.
+  size_t getLinkedFileCount() const { return LinkedFiles; }
+  /// Number of function bodies the pre-screen dropped in the last load.
+  size_t getDroppedFunctionCount() const { return DroppedFunctions; }
+
+private:
+  Options Opts;
+  /// Defined symbol name -> index of the input that provides it.
+  StringMap<size_t> Definitions;
+  std::vector<ModuleSummary> Summaries;
+  /// Functions that reach one of the screened library calls. Local functions
+  /// are qualified with the index of their input.
+  StringSet<> Relevant;
+  size_t LinkedFiles = 0;
+  size_t DroppedFunctions = 0;
+
+  bool buildIndex(const std::vector<std::string> &Inputs, LLVMContext &Context,
+                  std::string &Error);
+  void computeRelevant();
+  bool isRelevant(size_t Index, const Function &F) const;
+  void dropIrrelevant(size_t Index, Module &M);
+};
+
+#endif // PROJECT_LOADER_H
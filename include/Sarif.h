@@ -1,11 +1,14 @@
 #ifndef GENERATE_SARIF
 #define GENERATE_SARIF
 
-#include "json_hpp/json.hpp"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
 #include <fstream>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #if __has_include(<filesystem>)
 #include <filesystem>
@@ -21,7 +24,7 @@ using namespace llvm;
 class BugReport {
 public:
   SmallVector<std::pair<std::string, unsigned>> Trace;
-  StringRef RuleId;
+  std::string RuleId;
   int RuleIndex;
 
   BugReport(const SmallVector<std::pair<std::string, unsigned>> &Trace,
@@ -29,56 +32,47 @@ public:
       : Trace(Trace), RuleId(RuleId), RuleIndex(RuleIndex) {}
 };
 
-class Sarif {
-private:
-  using Key = std::string;
-  using Value = std::string;
+/// Writes a SARIF 2.1.0 log as it goes: the header on construction, every
+/// result as soon as it is added, the closing brackets in finish(). A log cut
+/// short by a timeout or crash still holds every result added before it.
+/// Only the notifications are kept in memory: SARIF places them in the run's
+/// invocation after the results, so they are written by finish() and lost
+/// with a crash.
+class SarifWriter {
+public:
+  /// Write to OS, which must outlive the writer. Compact output has no
+  /// indentation or line breaks.
+  explicit SarifWriter(raw_ostream &OS, bool Compact = false);
+  ~SarifWriter();
 
-  const Key Version = "version";
-  const Key Runs = "runs";
-  const Key Tool = "tool";
-  const Key Driver = "driver";
-  const Key ToolName = "name";
-  const Key Rules = "rules";
-  const Key Results = "results";
-  const Key RuleId = "id";
-  const Key Text = "text";
-  const Key ShortDescription = "shortDescription";
-  const Key Uri = "helpUri";
-  const Key FileUri = "uri";
-  const Key PhysicalLocation = "physicalLocation";
-  const Key ArtifactLocation = "artifactLocation";
-  const Key RuleID = "ruleId";
-  const Key RuleIndex = "ruleIndex";
-  const Key FunctionName = "functionName";
-  const Key Locations = "locations";
-  const Key Location = "location";
-  const Key Message = "message";
-  const Key Filepath = "filePath";
-  const Key Schema = "$schema";
-  const Key CodeFlows = "codeFlows";
-  const Key ThreadFlows = "threadFlows";
-  const Key Region = "region";
-  const Key StartLine = "startLine";
-  const Key StartColumn = "startColumn";
-  const Key InformationUri = "informationUri";
+  /// Create Path ("-" for stdout) and write to it. Returns nullptr and sets
+  /// Error if the file cannot be created.
+  static std::unique_ptr<SarifWriter> create(const std::string &Path, bool Compact,
+                                             std::string &Error);
+
+  void addResult(const BugReport &Result);
+  /// Copy the results of another log, e.g. one produced by a worker.
+  bool addResults(StringRef SarifText);
+  /// Record a warning about the run, e.g. a query cut short by a budget. The
+  /// notifications are written after the results, as those of the run's
+  /// invocation.
+  void addNotification(StringRef Message);
+  /// Close the log. Called by the destructor if needed.
+  void finish();
 
-  const Value SchemaURI = "https://json.schemastore.org/sarif-2.1.0";
-  const Value VersionValue = "2.1.0";
-  const Value TextMsgBO = "report if the line may occur to a buffer overflow error";
-  const Value TextMsgML = "report if the line may occur to a memory leak error";
-  const Value TextMsgUAF = "report if the line may occur to a use after free";
-  const Value UriAddrBO = "https://www.acunetix.com/blog/"
-                          "web-security-zone/what-is-buffer-overflow/";
-  const Value UriAddrML = "https://aticleworld.com/what-is-memory-leak-in-c-c-how-can-we-avoid/";
-  const Value UriAddrUAF = "https://encyclopedia.kaspersky.com/glossary/use-after-free/";
+private:
+  SarifWriter(std::unique_ptr<raw_fd_ostream> File, bool Compact);
 
-  const char *FileName = "report.sarif";
-  nlohmann::json GenSarif;
+  std::unique_ptr<raw_fd_ostream> File;
+  raw_ostream &OS;
+  json::OStream J;
+  std::vector<std::string> Notifications;
+  bool Finished = false;
 
-public:
-  Sarif();
-  void addResult(const BugReport &Result);
-  void save();
+  void writeHeader();
 };
+
+/// Read back the results of a log written by SarifWriter, e.g. to log the
+/// findings a worker reported. Returns false if the text is not such a log.
+bool readResults(StringRef SarifText, std::vector<BugReport> &Reports);
 #endif // GENERATE_SARIF
@@ -1,6 +1,9 @@
 #ifndef SIMPLE_PASS_H
 #define SIMPLE_PASS_H
 
+#include "Analyzer.h"
+#include "DebugLocIndex.h"
+#include "FuncInfoAnalysis.h"
 #include "Sarif.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/DebugInfoMetadata.h"
@@ -17,14 +20,26 @@ using namespace llvm;
 
 class SimplePass : public PassInfoMixin<SimplePass> {
 public:
-  PreservedAnalyses run(Module &M, ModuleAnalysisManager &);
-  void analyze(Module &M);
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM);
+  /// Without FAM, the Analyzer builds the FuncInfos itself.
+  void analyze(Module &M, FunctionAnalysisManager *FAM = nullptr);
+  static std::string getReportPath(const Module &M);
+  /// OnReport, if set, receives each finding as soon as it is found, so a
+  /// caller can write it out before the remaining checks run.
+  std::vector<BugReport> findBugs(Module &M, const AnalyzerOptions &Options = {},
+                                  const std::function<void(const BugReport &)> &OnReport = nullptr);
   std::string getFunctionLocation(const Function *Func);
   SmallVector<std::pair<std::string, unsigned>> getAllFunctionsTrace(Module &M);
-  static unsigned getFunctionFirstLine(const Function *Func);
-  static unsigned getInstructionLine(const Value *Inst);
+  unsigned getFunctionFirstLine(const Function *Func);
+  unsigned getInstructionLine(const Value *Inst);
 
   SmallVector<std::pair<std::string, unsigned>> createTraceOfPairInst(Value *start, Instruction *end);
-  };
+
+private:
+  /// Debug locations of the module being reported on, built on first use.
+  std::unique_ptr<DebugLocIndex> Locations;
+
+  const DebugLocIndex &getLocations(const Module &M);
+};
 
 #endif // SIMPLE_PASS_H
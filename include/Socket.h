@@ -0,0 +1,57 @@
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include "llvm/ADT/StringRef.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/// Open a listening socket. Address is either "unix:<path>" or "<host>:<port>".
+/// Returns -1 and sets Error on failure.
+int listenOn(StringRef Address, std::string &Error);
+
+/// Connect to an address in the same format as listenOn.
+int connectTo(StringRef Address, std::string &Error);
+
+/// A framed message: a header line "<word>... <payload size>\n" followed by
+/// the payload bytes. The first word is the command.
+struct Message {
+  std::vector<std::string> Args;
+  std::string Payload;
+
+  StringRef getCommand() const { return Args.empty() ? StringRef() : StringRef(Args.front()); }
+};
+
+/// Reads and writes framed messages on a connected socket. Sends are
+/// serialized so that a heartbeat thread can share the connection.
+class MessageStream {
+public:
+  explicit MessageStream(int Fd) : Fd(Fd) {}
+  ~MessageStream();
+  MessageStream(const MessageStream &) = delete;
+  MessageStream &operator=(const MessageStream &) = delete;
+
+  int getFd() const { return Fd; }
+
+  bool send(const std::vector<std::string> &Args, StringRef Payload = "");
+
+  /// Blocking receive of the next message. Returns false on EOF or error.
+  bool receive(Message &Msg);
+
+  /// Read what is available without blocking and move complete messages to
+  /// Received. Returns false once the peer has closed the connection.
+  bool poll(std::vector<Message> &Received);
+
+  void close();
+
+private:
+  int Fd;
+  std::string Buffer;
+  std::mutex SendMutex;
+
+  bool takeMessage(Message &Msg);
+};
+
+#endif // SOCKET_H
@@ -0,0 +1,71 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include "BatchDriver.h"
+#include <chrono>
+#include <deque>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/// Runs the analysis in forked worker processes so that a crash, a
+/// report_fatal_error or a runaway input only costs the input being analyzed.
+/// Inputs are sharded round-robin over the workers. A worker that dies is
+/// restarted on the rest of its shard, and per-input results are merged in
+/// input order at the end.
+class Supervisor {
+public:
+  struct Options {
+    unsigned Workers = 1;
+    /// Wall-clock limit per input in seconds, 0 for no limit.
+    unsigned TimeoutSec = 0;
+    /// Resident set size limit per worker in megabytes, 0 for no limit.
+    size_t MaxRSSMB = 0;
+    /// Directory for per-input results; a temporary one is used if empty.
+    std::string ShardDir;
+    /// Merged report of all inputs, none if empty.
+    std::string MergedOutput = "report.sarif";
+    /// Also write the findings of all inputs to this binary findings log.
+    std::string FindingsLog;
+    bool Compact = false;
+    /// Applied by every worker to each input of its shard.
+    AnalyzerOptions Analysis;
+    bool LazyLoad = false;
+  };
+
+  enum class Status { Pending, Done, ParseError, Crashed, TimedOut, OutOfMemory };
+
+  Supervisor(std::vector<std::string> Inputs, Options Opts);
+
+  /// Returns the number of inputs that could not be analyzed.
+  unsigned run();
+
+  Status getStatus(size_t Index) const { return Statuses[Index]; }
+
+private:
+  struct Worker {
+    pid_t Pid = -1;
+    int Fd = -1;
+    std::deque<size_t> Shard;
+    /// Input currently being analyzed, -1 if none.
+    long Current = -1;
+    std::chrono::steady_clock::time_point Started;
+    Status KillReason = Status::Crashed;
+    std::string Pending;
+  };
+
+  std::vector<std::string> Inputs;
+  Options Opts;
+  std::vector<Status> Statuses;
+  std::vector<Worker> Workers;
+
+  std::string getResultPath(size_t Index) const;
+  bool spawn(Worker &W);
+  [[noreturn]] void runShard(Worker &W);
+  void readMessages(Worker &W);
+  void reap(Worker &W);
+  void enforceLimits(Worker &W);
+  void writeMergedReport();
+};
+
+#endif // SUPERVISOR_H
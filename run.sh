@@ -24,7 +24,13 @@ function check_build() {
 }
 
 function run_pass() {
-  opt-12 -load-pass-plugin "$PASS_PATH" -passes=simple -disable-output "$GIVEN_BC"
+  if [ -n "$ANALYZER_SOCKET" ] && [ -x "$CLIENT_PATH" ]; then
+    "$CLIENT_PATH" -socket "$ANALYZER_SOCKET" -o report.sarif "$GIVEN_BC"
+  elif [ -x "$ANALYZER_PATH" ]; then
+    "$ANALYZER_PATH" -o report.sarif "$GIVEN_BC"
+  else
+    opt-12 -load-pass-plugin "$PASS_PATH" -passes=simple -disable-output "$GIVEN_BC"
+  fi
   FILE=$(basename "$GIVEN_BC")
   FILE_NAME=${FILE%.*}
   if [ ! -f "report.sarif" ]; then
@@ -37,6 +43,8 @@ function main() {
 
   GIVEN_BC=$(realpath "$1")
   PASS_PATH="$ROOT_DIR/build/src/libAnalyzer.so"
+  ANALYZER_PATH="$ROOT_DIR/build/src/analyzer"
+  CLIENT_PATH="$ROOT_DIR/build/src/analyzer-client"
 
   check_build
   run_pass
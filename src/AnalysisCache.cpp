@@ -0,0 +1,388 @@
+#include "AnalysisCache.h"
+#include "SimplePass.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace {
+
+const char Magic[8] = {'A', 'N', 'C', 'A', 'C', 'H', 'E', '\0'};
+const uint32_t FormatVersion = 1;
+
+void addInt(MD5 &Hasher, uint64_t Value) {
+  uint8_t Bytes[8];
+  support::endian::write64le(Bytes, Value);
+  Hasher.update(Bytes);
+}
+
+void addString(MD5 &Hasher, StringRef Str) {
+  addInt(Hasher, Str.size());
+  Hasher.update(Str);
+}
+
+void addType(MD5 &Hasher, Type *Ty) {
+  std::string Name;
+  raw_string_ostream OS(Name);
+  Ty->print(OS);
+  addString(Hasher, OS.str());
+}
+
+/// Bounds-checked reader over an encoded entry.
+class Reader {
+public:
+  explicit Reader(StringRef Data) : Data(Data) {}
+
+  bool read32(uint32_t &Value) {
+    if (Data.size() < 4) {
+      return false;
+    }
+    Value = support::endian::read32le(Data.data());
+    Data = Data.drop_front(4);
+    return true;
+  }
+
+  bool readString(std::string &Str) {
+    uint32_t Size = 0;
+    if (!read32(Size) || Data.size() < Size) {
+      return false;
+    }
+    Str = Data.take_front(Size).str();
+    Data = Data.drop_front(Size);
+    return true;
+  }
+
+  bool skip(size_t Size) {
+    if (Data.size() < Size) {
+      return false;
+    }
+    Data = Data.drop_front(Size);
+    return true;
+  }
+
+  StringRef rest() const { return Data; }
+
+private:
+  StringRef Data;
+};
+
+bool decodeReports(StringRef Data, std::vector<BugReport> &Reports) {
+  Reports.clear();
+  Reader R(Data);
+  uint32_t Count = 0;
+  if (!R.read32(Count)) {
+    return false;
+  }
+  for (uint32_t I = 0; I < Count; ++I) {
+    uint32_t RuleIndex = 0;
+    uint32_t TraceSize = 0;
+    std::string RuleId;
+    if (!R.read32(RuleIndex) || !R.readString(RuleId) || !R.read32(TraceSize)) {
+      return false;
+    }
+    SmallVector<std::pair<std::string, unsigned>> Trace;
+    for (uint32_t J = 0; J < TraceSize; ++J) {
+      std::string File;
+      uint32_t Line = 0;
+      if (!R.readString(File) || !R.read32(Line)) {
+        return false;
+      }
+      Trace.emplace_back(File, Line);
+    }
+    Reports.emplace_back(Trace, RuleId, static_cast<int>(RuleIndex));
+  }
+  return true;
+}
+
+/// Size of the encoded entry at the start of Data, or 0 if it is truncated.
+size_t measureEntry(StringRef Data) {
+  Reader R(Data);
+  uint32_t Count = 0;
+  if (!R.read32(Count)) {
+    return 0;
+  }
+  for (uint32_t I = 0; I < Count; ++I) {
+    uint32_t RuleIndex = 0;
+    uint32_t TraceSize = 0;
+    std::string RuleId;
+    if (!R.read32(RuleIndex) || !R.readString(RuleId) || !R.read32(TraceSize)) {
+      return 0;
+    }
+    for (uint32_t J = 0; J < TraceSize; ++J) {
+      std::string File;
+      uint32_t Line = 0;
+      if (!R.readString(File) || !R.read32(Line)) {
+        return 0;
+      }
+    }
+  }
+  return Data.size() - R.rest().size();
+}
+
+void encodeString(support::endian::Writer &W, StringRef Str) {
+  W.write<uint32_t>(Str.size());
+  W.OS << Str;
+}
+
+void encodeReports(support::endian::Writer &W, const std::vector<BugReport> &Reports) {
+  W.write<uint32_t>(Reports.size());
+  for (const BugReport &Report : Reports) {
+    W.write<uint32_t>(static_cast<uint32_t>(Report.RuleIndex));
+    encodeString(W, Report.RuleId);
+    W.write<uint32_t>(Report.Trace.size());
+    for (const auto &Elem : Report.Trace) {
+      encodeString(W, Elem.first);
+      W.write<uint32_t>(Elem.second);
+    }
+  }
+}
+
+} // namespace
+
+void StructuralHasher::hashBody(Function &F, MD5 &Hasher) {
+  std::unordered_map<const Value *, uint64_t> Numbers;
+  for (Argument &Arg : F.args()) {
+    Numbers[&Arg] = Numbers.size();
+  }
+  for (BasicBlock &BB : F) {
+    Numbers[&BB] = Numbers.size();
+    for (Instruction &Inst : BB) {
+      Numbers[&Inst] = Numbers.size();
+    }
+  }
+
+  addString(Hasher, F.getName());
+  addType(Hasher, F.getFunctionType());
+  for (Instruction &Inst : instructions(F)) {
+    addInt(Hasher, Inst.getOpcode());
+    addType(Hasher, Inst.getType());
+    if (auto *Cmp = dyn_cast<CmpInst>(&Inst)) {
+      addInt(Hasher, Cmp->getPredicate());
+    }
+    if (const DebugLoc &Loc = Inst.getDebugLoc()) {
+      addInt(Hasher, Loc.getLine());
+      addInt(Hasher, Loc.getCol());
+      if (auto *Scope = dyn_cast<DIScope>(Loc.getScope())) {
+        addString(Hasher, Scope->getFilename());
+        addString(Hasher, Scope->getDirectory());
+      }
+    }
+
+    for (Value *Op : Inst.operands()) {
+      auto Local = Numbers.find(Op);
+      if (Local != Numbers.end()) {
+        Hasher.update("L");
+        addInt(Hasher, Local->second);
+      } else if (auto *GV = dyn_cast<GlobalValue>(Op)) {
+        Hasher.update("G");
+        addString(Hasher, GV->getName());
+        addType(Hasher, GV->getValueType());
+      } else if (auto *C = dyn_cast<Constant>(Op)) {
+        std::string Text;
+        raw_string_ostream OS(Text);
+        C->print(OS);
+        Hasher.update("C");
+        addString(Hasher, OS.str());
+      } else if (isa<MetadataAsValue>(Op)) {
+        Hasher.update("M");
+      } else {
+        Hasher.update("?");
+      }
+    }
+  }
+}
+
+StructuralHasher::Hash StructuralHasher::getHash(Function &F) {
+  auto Known = Hashes.find(&F);
+  if (Known != Hashes.end()) {
+    return Known->second;
+  }
+
+  if (F.isMaterializable()) {
+    if (Error E = F.materialize()) {
+      consumeError(std::move(E));
+      return {};
+    }
+  }
+
+  MD5 Hasher;
+  hashBody(F, Hasher);
+
+  // Recursive calls contribute only the callee name; the cycle is covered by
+  // the bodies hashed above it.
+  InProgress[&F] = true;
+  for (Instruction &Inst : instructions(F)) {
+    auto *Call = dyn_cast<CallBase>(&Inst);
+    Function *Callee = Call ? Call->getCalledFunction() : nullptr;
+    if (!Callee || Callee->isDeclarationForLinker()) {
+      continue;
+    }
+    if (InProgress[Callee]) {
+      Hasher.update("R");
+      addString(Hasher, Callee->getName());
+      continue;
+    }
+    Hash CalleeHash = getHash(*Callee);
+    Hasher.update(CalleeHash);
+  }
+  InProgress[&F] = false;
+
+  MD5::MD5Result Result;
+  Hasher.final(Result);
+  Hash H;
+  std::copy(Result.Bytes.begin(), Result.Bytes.end(), H.begin());
+  Hashes[&F] = H;
+  return H;
+}
+
+AnalysisCache::Key AnalysisCache::computeKey(Module &M, const AnalyzerOptions &Options) {
+  MD5 Hasher;
+  addInt(Hasher, FormatVersion);
+  addInt(Hasher, Options.mlCheck | Options.uafCheck << 1 | Options.bofCheck << 2 | Options.prescreen << 3 |
+                     Options.slice << 4);
+  addInt(Hasher, Options.inlineThreshold);
+  addString(Hasher, M.getDataLayoutStr());
+  if (Function *Main = M.getFunction("main")) {
+    if (!Main->isDeclaration()) {
+      Hasher.update(StructuralHasher().getHash(*Main));
+    }
+  }
+
+  MD5::MD5Result Result;
+  Hasher.final(Result);
+  Key K;
+  std::copy(Result.Bytes.begin(), Result.Bytes.end(), K.begin());
+  return K;
+}
+
+bool AnalysisCache::load(const std::string &Path) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Stored.clear();
+  Buffer.reset();
+  if (!sys::fs::exists(Path)) {
+    return true;
+  }
+
+  auto File = MemoryBuffer::getFile(Path);
+  if (!File) {
+    errs() << "warning: cannot read cache " << Path << ": " << File.getError().message() << "\n";
+    return false;
+  }
+
+  Reader R((*File)->getBuffer());
+  uint32_t Version = 0;
+  uint32_t Count = 0;
+  if (!R.rest().startswith(StringRef(Magic, sizeof(Magic))) || !R.skip(sizeof(Magic)) ||
+      !R.read32(Version) || Version != FormatVersion || !R.read32(Count)) {
+    errs() << "warning: ignoring incompatible cache " << Path << "\n";
+    return false;
+  }
+
+  for (uint32_t I = 0; I < Count; ++I) {
+    Key K;
+    StringRef Rest = R.rest();
+    size_t Size = Rest.size() >= K.size() ? measureEntry(Rest.drop_front(K.size())) : 0;
+    if (!Size) {
+      errs() << "warning: ignoring corrupt cache " << Path << "\n";
+      Stored.clear();
+      return false;
+    }
+    std::copy(Rest.bytes_begin(), Rest.bytes_begin() + K.size(), K.begin());
+    Stored[K] = Rest.substr(K.size(), Size);
+    R.skip(K.size() + Size);
+  }
+  Buffer = std::move(*File);
+  return true;
+}
+
+bool AnalysisCache::save(const std::string &Path) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  std::string TempPath = Path + ".tmp";
+  {
+    std::error_code EC;
+    raw_fd_ostream OS(TempPath, EC);
+    if (EC) {
+      errs() << "warning: cannot write cache " << TempPath << ": " << EC.message() << "\n";
+      return false;
+    }
+
+    size_t Count = Added.size();
+    for (const auto &Entry : Stored) {
+      Count += !Added.count(Entry.first);
+    }
+
+    support::endian::Writer W(OS, support::little);
+    OS.write(Magic, sizeof(Magic));
+    W.write<uint32_t>(FormatVersion);
+    W.write<uint32_t>(Count);
+    for (const auto &Entry : Stored) {
+      if (!Added.count(Entry.first)) {
+        OS.write(reinterpret_cast<const char *>(Entry.first.data()), Entry.first.size());
+        OS << Entry.second;
+      }
+    }
+    for (const auto &Entry : Added) {
+      OS.write(reinterpret_cast<const char *>(Entry.first.data()), Entry.first.size());
+      encodeReports(W, Entry.second);
+    }
+  }
+  return !sys::fs::rename(TempPath, Path);
+}
+
+bool AnalysisCache::lookup(const Key &K, std::vector<BugReport> &Reports) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto New = Added.find(K);
+  if (New != Added.end()) {
+    Reports = New->second;
+    ++Hits;
+    return true;
+  }
+  auto Old = Stored.find(K);
+  if (Old != Stored.end() && decodeReports(Old->second, Reports)) {
+    ++Hits;
+    return true;
+  }
+  Reports.clear();
+  ++Misses;
+  return false;
+}
+
+void AnalysisCache::insert(const Key &K, const std::vector<BugReport> &Reports) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Added[K] = Reports;
+}
+
+std::vector<BugReport> AnalysisCache::findBugs(Module &M, const AnalyzerOptions &Options,
+                                               const std::function<void(const BugReport &)> &OnReport) {
+  // A diff-scoped run sees only part of the module, so its findings are no
+  // answer for the module as a whole.
+  if (Options.isChanged) {
+    return SimplePass().findBugs(M, Options, OnReport);
+  }
+  Key K = computeKey(M, Options);
+  std::vector<BugReport> Reports;
+  if (lookup(K, Reports)) {
+    if (OnReport) {
+      for (const BugReport &Report : Reports) {
+        OnReport(Report);
+      }
+    }
+    return Reports;
+  }
+  // Findings of an analysis cut short by a budget or a cancellation are not
+  // the answer either.
+  bool Truncated = false;
+  AnalyzerOptions Analysis = Options;
+  Analysis.onTruncated = [&Truncated, &Options](const std::string &What) {
+    Truncated = true;
+    if (Options.onTruncated) {
+      Options.onTruncated(What);
+    }
+  };
+  Reports = SimplePass().findBugs(M, Analysis, OnReport);
+  if (!Truncated && !(Options.isCancelled && Options.isCancelled())) {
+    insert(K, Reports);
+  }
+  return Reports;
+}
@@ -1,4 +1,8 @@
 #include "Analyzer.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include <atomic>
+#include <thread>
 
 namespace llvm {
 
@@ -6,57 +10,422 @@ const std::pair<std::string, int> BugType::UseAfterFree = {"use-after-free", 0};
 const std::pair<std::string, int> BugType::MemoryLeak = {"memory-leak", 1};
 const std::pair<std::string, int> BugType::BufferOverFlow = {"buffer-overflow", 2};
 
-Analyzer::Analyzer(Module &m) {
+Analyzer::Analyzer(Module &m, const AnalyzerOptions &opts) {
   module = &m;
+  options = opts;
+  if (options.timeBudget > 0) {
+    deadline = options.budgetStart.value_or(std::chrono::steady_clock::now()) +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double>(options.timeBudget));
+  }
   mainFunc = m.getFunction("main");
   if (!mainFunc) {
     return;
   }
-  callGraph = std::make_unique<CallGraph>(*module);
+  size_t ordinal = 0;
+  for (Function &function : *module) {
+    funcOrdinals[&function] = ordinal++;
+  }
   AnalyzeFunctions();
 }
 
+size_t Analyzer::GetFunctionOrdinal(Function *function) const {
+  auto it = funcOrdinals.find(function);
+  if (it == funcOrdinals.end()) {
+    return SIZE_MAX;
+  }
+  return it->second;
+}
+
+const AnalyzerOptions &Analyzer::GetOptions() const {
+  return options;
+}
+
+// Once cancelled, stay cancelled without asking the callback again.
+bool Analyzer::IsCancelled() {
+  if (!cancelled && options.isCancelled && options.isCancelled()) {
+    cancelled = true;
+  }
+  return cancelled;
+}
+
+bool Analyzer::OutOfTime() const {
+  return deadline != std::chrono::steady_clock::time_point::max() &&
+         std::chrono::steady_clock::now() >= deadline;
+}
+
+void Analyzer::ReportTruncated(const std::string &what) {
+  if (options.onTruncated) {
+    options.onTruncated(what);
+  }
+}
+
+void Analyzer::ReportProgress(const char *stage, size_t done, size_t total) {
+  if (options.progress && !cancelled) {
+    std::lock_guard<std::mutex> lock(progressMutex);
+    options.progress(stage, done, total);
+  }
+}
+
+const std::vector<Function *> &Analyzer::GetAnalyzedFunctions() const {
+  return funcQueue;
+}
+
+// Load the body of a function from a lazily read module. Modules that were
+// parsed completely have nothing left to materialize.
+bool Analyzer::Materialize(Function *function) {
+  if (!function->isMaterializable()) {
+    return true;
+  }
+  if (Error error = function->materialize()) {
+    errs() << "cannot materialize " << function->getName() << ": " << toString(std::move(error)) << "\n";
+    return false;
+  }
+  return true;
+}
+
+// Walk the direct calls starting from main. With a lazily loaded module only
+// the bodies reached here are ever deserialized.
 void Analyzer::AnalyzeFunctions() {
   std::stack<Function *> functionStack;
   std::unordered_set<Function *> visitedFunctions;
+  std::unordered_map<Function *, std::vector<Function *>> callers;
   functionStack.push(mainFunc);
 
   while (!functionStack.empty()) {
     Function *current = functionStack.top();
     functionStack.pop();
 
+    if (!visitedFunctions.insert(current).second || !Materialize(current)) {
+      continue;
+    }
     funcQueue.push_back(current);
-    funcInfos[current] = std::make_shared<FuncInfo>(current);
-
-    errs() << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~`\n";
-    funcInfos[current]->printMap(AnalyzerMap::ForwardDependencyMap);
-    errs() << "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~`\n";
 
-    visitedFunctions.insert(current);
-    for (const auto &node : *callGraph->operator[](current)) {
-      Function *next = node.second->getFunction();
+    for (Instruction &inst : instructions(current)) {
+      auto *call = dyn_cast<CallBase>(&inst);
+      if (!call) {
+        continue;
+      }
+      Function *next = call->getCalledFunction();
+      if (!next || next->isDeclarationForLinker()) {
+        continue;
+      }
+      if (options.isChanged || options.prescreen) {
+        callers[next].push_back(current);
+      }
       if (visitedFunctions.find(next) == visitedFunctions.end()) {
-        if (next->isDeclarationForLinker()) {
-          continue;
-        }
         functionStack.push(next);
       }
     }
   }
+
+  if (options.isChanged) {
+    RestrictToCallersOf([this](Function *function) { return options.isChanged(*function); }, callers,
+                        PassesPointer);
+  }
+  if (options.prescreen) {
+    RestrictToCallersOf(HasRelevantOperations, callers, PassesPointer);
+  }
+
+  std::sort(funcQueue.begin(), funcQueue.end(), [this](Function *lhs, Function *rhs) {
+    return GetFunctionOrdinal(lhs) < GetFunctionOrdinal(rhs);
+  });
+  if (options.onMaterialized) {
+    options.onMaterialized(*module);
+  }
+  // Also makes the materializer of a lazily read module drop the debug info
+  // of bodies read later.
+  if (options.stripDebugInfo) {
+    StripDebugInfo(*module);
+  }
+  if (options.inlineThreshold) {
+    CloneFunctions();
+  }
+  ConstructFuncInfos();
+}
+
+// Keep the seed functions and everything that calls them on the way from
+// main, then the callees that keepCallee accepts at a call from a kept
+// function. Other callees get no FuncInfo, and the checkers treat calls to
+// them like calls to declarations.
+void Analyzer::RestrictToCallersOf(const std::function<bool(Function *)> &isSeed,
+                                   const std::unordered_map<Function *, std::vector<Function *>> &callers,
+                                   const std::function<bool(CallBase *)> &keepCallee) {
+  std::unordered_set<Function *> cone;
+  std::stack<Function *> worklist;
+  for (Function *function : funcQueue) {
+    if (isSeed(function) && cone.insert(function).second) {
+      worklist.push(function);
+    }
+  }
+  while (!worklist.empty()) {
+    Function *current = worklist.top();
+    worklist.pop();
+    auto it = callers.find(current);
+    if (it == callers.end()) {
+      continue;
+    }
+    for (Function *caller : it->second) {
+      if (cone.insert(caller).second) {
+        worklist.push(caller);
+      }
+    }
+  }
+
+  if (keepCallee) {
+    std::unordered_set<Function *> reachable(funcQueue.begin(), funcQueue.end());
+    for (Function *function : cone) {
+      worklist.push(function);
+    }
+    while (!worklist.empty()) {
+      Function *current = worklist.top();
+      worklist.pop();
+      for (Instruction &inst : instructions(current)) {
+        auto *call = dyn_cast<CallBase>(&inst);
+        Function *callee = call ? call->getCalledFunction() : nullptr;
+        if (callee && reachable.count(callee) && keepCallee(call) && cone.insert(callee).second) {
+          worklist.push(callee);
+        }
+      }
+    }
+  }
+
+  funcQueue.erase(std::remove_if(funcQueue.begin(), funcQueue.end(),
+                                 [&cone](Function *function) { return !cone.count(function); }),
+                  funcQueue.end());
+}
+
+// A callee given a pointer may free it or store through it, which the
+// checkers follow from the caller's objects.
+bool Analyzer::PassesPointer(CallBase *call) {
+  return std::any_of(call->arg_begin(), call->arg_end(),
+                     [](const Use &arg) { return arg->getType()->isPointerTy(); });
+}
+
+// One linear pass over the instructions: the library calls the checkers
+// start from, and arrays, which the buffer overflow checker inspects.
+bool Analyzer::HasRelevantOperations(Function *function) {
+  for (Instruction &inst : instructions(function)) {
+    if (auto *call = dyn_cast<CallBase>(&inst)) {
+      Function *callee = call->getCalledFunction();
+      if (callee && IsRelevantCall(callee->getName())) {
+        return true;
+      }
+    } else if (auto *alloca = dyn_cast<AllocaInst>(&inst)) {
+      if (alloca->getAllocatedType()->isArrayTy()) {
+        return true;
+      }
+    } else if (auto *gep = dyn_cast<GetElementPtrInst>(&inst)) {
+      if (gep->getSourceElementType()->isArrayTy()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// From here on the Analyzer works on the copy: the functions to analyze and
+// main are replaced by their clones. Helpers inlined at every call site are
+// not analyzed on their own.
+void Analyzer::CloneFunctions() {
+  clone = std::make_unique<ClonedModule>(*module, funcQueue);
+  clone->InlineSmallFunctions(options.inlineThreshold);
+
+  std::unordered_map<Function *, size_t> cloneOrdinals;
+  for (const auto &entry : funcOrdinals) {
+    if (Function *cloned = clone->GetClone(entry.first)) {
+      cloneOrdinals[cloned] = entry.second;
+    }
+  }
+  funcOrdinals = std::move(cloneOrdinals);
+  for (Function *&function : funcQueue) {
+    function = clone->GetClone(function);
+  }
+  mainFunc = clone->GetClone(mainFunc);
+  funcQueue.erase(std::remove_if(funcQueue.begin(), funcQueue.end(),
+                                 [this](Function *function) {
+                                   return function != mainFunc && function->use_empty();
+                                 }),
+                  funcQueue.end());
+}
+
+std::pair<Value *, Instruction *> Analyzer::MapToOriginal(const std::pair<Value *, Instruction *> &trace) const {
+  if (!clone) {
+    return trace;
+  }
+  return {clone->GetOriginal(trace.first), dyn_cast_or_null<Instruction>(clone->GetOriginal(trace.second))};
+}
+
+// FuncInfo only reads the IR of its own function, so the reachable functions
+// can be processed concurrently.
+void Analyzer::ConstructFuncInfos() {
+  if (options.graphBudget) {
+    ConstructFuncInfosBottomUp();
+    return;
+  }
+
+  // A provided FuncInfo may have been checked before.
+  bool provided = options.funcInfoProvider && !clone;
+  std::vector<std::shared_ptr<FuncInfo>> infos(funcQueue.size());
+  std::atomic<size_t> next(0);
+  std::atomic<size_t> built(0);
+  auto worker = [this, provided, &infos, &next, &built]() {
+    for (size_t i = next++; i < funcQueue.size() && !IsCancelled() && !OutOfTime(); i = next++) {
+      if (provided) {
+        infos[i] = options.funcInfoProvider(*funcQueue[i]);
+        infos[i]->ResetCheckResults();
+      } else {
+        infos[i] = std::make_shared<FuncInfo>(funcQueue[i], nullptr, options.slice);
+      }
+      ReportProgress("graphs", ++built, funcQueue.size());
+    }
+  };
+
+  size_t numThreads = provided ? 1 : std::min<size_t>(std::max(1u, options.threads), funcQueue.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < numThreads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  if (IsCancelled()) {
+    return;
+  }
+  if (built < funcQueue.size()) {
+    ReportTruncated("graphs: built " + std::to_string(built) + " of " +
+                    std::to_string(funcQueue.size()) + " functions before the time budget ran out");
+  }
+
+  for (size_t i = 0; i < funcQueue.size(); ++i) {
+    // Functions without graphs are left out like declarations.
+    if (!infos[i]) {
+      continue;
+    }
+    funcInfos[funcQueue[i]] = infos[i];
+  }
+}
+
+// Callees come before their callers, so a caller's graphs are built while
+// the summaries of everything it calls already exist.
+std::vector<Function *> Analyzer::GetBottomUpOrder() const {
+  std::unordered_set<Function *> reachable(funcQueue.begin(), funcQueue.end());
+  std::unordered_set<Function *> visited;
+  std::vector<Function *> order;
+  if (!reachable.count(mainFunc)) {
+    return order;
+  }
+  std::stack<std::pair<Function *, bool>> stack;
+  stack.push({mainFunc, false});
+
+  while (!stack.empty()) {
+    auto [current, expanded] = stack.top();
+    stack.pop();
+    if (expanded) {
+      order.push_back(current);
+      continue;
+    }
+    if (!visited.insert(current).second) {
+      continue;
+    }
+    stack.push({current, true});
+    for (Instruction &inst : instructions(current)) {
+      auto *call = dyn_cast<CallBase>(&inst);
+      Function *next = call ? call->getCalledFunction() : nullptr;
+      if (next && reachable.count(next) && !visited.count(next)) {
+        stack.push({next, false});
+      }
+    }
+  }
+  return order;
+}
+
+// Build one FuncInfo at a time under the graph budget. Only the summaries of
+// finished functions are guaranteed to stay in memory.
+void Analyzer::ConstructFuncInfosBottomUp() {
+  graphBudget = std::make_unique<GraphBudget>(options.graphBudget);
+  std::vector<Function *> order = GetBottomUpOrder();
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (IsCancelled()) {
+      funcInfos.clear();
+      return;
+    }
+    // Callers come last, so main loses its graphs first and the checks are
+    // skipped.
+    if (OutOfTime()) {
+      ReportTruncated("graphs: built " + std::to_string(i) + " of " + std::to_string(order.size()) +
+                      " functions before the time budget ran out");
+      return;
+    }
+    auto info = std::make_shared<FuncInfo>(order[i], graphBudget.get(), options.slice);
+    funcInfos[order[i]] = info;
+    ReportProgress("graphs", i + 1, order.size());
+  }
+}
+
+QueryBudget Analyzer::GetQueryBudget() const {
+  QueryBudget budget;
+  budget.deadline = deadline;
+  budget.nodes = options.queryNodeBudget;
+  budget.edges = options.queryEdgeBudget;
+  return budget;
+}
+
+// A checker runs only with the graphs of main and while there is time left.
+bool Analyzer::StartCheck(const char *name) {
+  if (IsCancelled()) {
+    return false;
+  }
+  auto mainInfo = funcInfos.find(mainFunc);
+  if (mainInfo == funcInfos.end() || !mainInfo->second) {
+    return false;
+  }
+  if (OutOfTime()) {
+    ReportTruncated(std::string(name) + ": skipped, the time budget ran out");
+    return false;
+  }
+  return true;
+}
+
+void Analyzer::FinishCheck(const char *name, const Checker &checker) {
+  if (size_t stopped = checker.GetStoppedQueries()) {
+    ReportTruncated(std::string(name) + ": " + std::to_string(stopped) + " " +
+                    (stopped == 1 ? "query" : "queries") + " stopped early, " +
+                    checker.GetStopReason());
+  }
 }
 
 std::shared_ptr<BugTrace> Analyzer::MLCheck() {
+  if (!StartCheck(BugType::MemoryLeak.first.c_str())) {
+    return {nullptr};
+  }
   std::shared_ptr<MLChecker> mlChecker = std::make_shared<MLChecker>(funcInfos);
-  auto trace = mlChecker->Check(mainFunc);
+  mlChecker->SetBudget(GetQueryBudget());
+  auto trace = MapToOriginal(mlChecker->Check(mainFunc));
+  FinishCheck(BugType::MemoryLeak.first.c_str(), *mlChecker);
   if (trace.first && trace.second) {
     return std::make_shared<BugTrace>(trace, BugType::MemoryLeak);
   }
+  // Check stops at the first leak, so only a clean run has seen every free.
+  freesMatched = true;
   return {nullptr};
 }
 
 std::shared_ptr<BugTrace> Analyzer::UAFCheck() {
+  if (!StartCheck(BugType::UseAfterFree.first.c_str())) {
+    return {nullptr};
+  }
+  if (!freesMatched) {
+    MLChecker mlChecker(funcInfos);
+    mlChecker.SetBudget(GetQueryBudget());
+    mlChecker.MatchFreeCalls(mainFunc);
+    freesMatched = true;
+  }
   std::unique_ptr<UAFChecker> uafChecker = std::make_unique<UAFChecker>(funcInfos);
-  auto trace = uafChecker->Check(mainFunc);
+  uafChecker->SetBudget(GetQueryBudget());
+  auto trace = MapToOriginal(uafChecker->Check(mainFunc));
+  FinishCheck(BugType::UseAfterFree.first.c_str(), *uafChecker);
   if (trace.first && trace.second) {
     return std::make_shared<BugTrace>(trace, BugType::UseAfterFree);
   }
@@ -64,8 +433,13 @@ std::shared_ptr<BugTrace> Analyzer::UAFCheck() {
 }
 
 std::shared_ptr<BugTrace> Analyzer::BOFCheck() {
+  if (!StartCheck(BugType::BufferOverFlow.first.c_str())) {
+    return {nullptr};
+  }
   std::shared_ptr<BOFChecker> bofChecker = std::make_shared<BOFChecker>(funcInfos);
-  auto trace = bofChecker->Check(mainFunc);
+  bofChecker->SetBudget(GetQueryBudget());
+  auto trace = MapToOriginal(bofChecker->Check(mainFunc));
+  FinishCheck(BugType::BufferOverFlow.first.c_str(), *bofChecker);
   if (trace.first && trace.second) {
     return std::make_shared<BugTrace>(trace, BugType::BufferOverFlow);
   }
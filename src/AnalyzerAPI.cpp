@@ -0,0 +1,101 @@
+#include "AnalyzerAPI.h"
+#include "SimplePass.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <atomic>
+
+namespace {
+
+Finding toFinding(const BugReport &Report) {
+  Finding Result;
+  Result.RuleId = Report.RuleId;
+  Result.RuleIndex = Report.RuleIndex;
+  for (const auto &Step : Report.Trace) {
+    Result.Trace.push_back({Step.first, Step.second});
+  }
+  return Result;
+}
+
+/// Analyze a module nobody else looks at; the checkers rename its values and
+/// debug-lite strips its debug info.
+AnalysisResult analyzeOwnModule(Module &M, const AnalysisOptions &Options) {
+  AnalysisResult Result;
+  // Remember the answer, so a callback that turns false again cannot make a
+  // partial analysis look complete.
+  std::atomic<bool> Cancelled(false);
+  AnalyzerOptions Analysis = Options.Analysis;
+  if (Options.IsCancelled) {
+    Analysis.isCancelled = [&Cancelled, &Options]() {
+      if (!Cancelled && Options.IsCancelled()) {
+        Cancelled = true;
+      }
+      return Cancelled.load();
+    };
+  }
+  if (Options.Progress) {
+    Analysis.progress = [&Options](const char *Stage, size_t Done, size_t Total) {
+      Options.Progress(Stage, Done, Total);
+    };
+  }
+
+  Analysis.onTruncated = [&Result, &Options](const std::string &What) {
+    Result.Truncated.push_back(What);
+    if (Options.Analysis.onTruncated) {
+      Options.Analysis.onTruncated(What);
+    }
+  };
+
+  std::vector<BugReport> Reports = SimplePass().findBugs(M, Analysis);
+  if (Cancelled) {
+    Result.Cancelled = true;
+    return Result;
+  }
+  for (const BugReport &Report : Reports) {
+    Result.Findings.push_back(toFinding(Report));
+  }
+  return Result;
+}
+
+} // namespace
+
+AnalysisResult analyzeModule(Module &M, const AnalysisOptions &Options) {
+  // CloneModule needs every body.
+  if (Error E = M.materializeAll()) {
+    AnalysisResult Result;
+    Result.Error = toString(std::move(E));
+    return Result;
+  }
+  std::unique_ptr<Module> Copy = CloneModule(M);
+  return analyzeOwnModule(*Copy, Options);
+}
+
+AnalysisResult analyzeBuffer(MemoryBufferRef Buffer, const AnalysisOptions &Options) {
+  AnalysisResult Result;
+  if (Options.IsCancelled && Options.IsCancelled()) {
+    Result.Cancelled = true;
+    return Result;
+  }
+  if (Options.Progress) {
+    Options.Progress("parse", 0, 1);
+  }
+
+  LLVMContext Context;
+  SMDiagnostic Diag;
+  std::unique_ptr<Module> M =
+      Options.LazyLoad ? getLazyIRModule(MemoryBuffer::getMemBuffer(Buffer, false), Diag, Context)
+                       : parseIR(Buffer, Diag, Context);
+  if (!M) {
+    raw_string_ostream OS(Result.Error);
+    Diag.print("analyzer", OS, false);
+    OS.flush();
+    if (Result.Error.empty()) {
+      Result.Error = "cannot parse " + Buffer.getBufferIdentifier().str();
+    }
+    return Result;
+  }
+  if (Options.Progress) {
+    Options.Progress("parse", 1, 1);
+  }
+  return analyzeOwnModule(*M, Options);
+}
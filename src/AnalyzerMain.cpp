@@ -0,0 +1,213 @@
+#include "AnalysisCache.h"
+#include "BatchDriver.h"
+#include "Daemon.h"
+#include "DiffScope.h"
+#include "ProjectLoader.h"
+#include "SimplePass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include <thread>
+
+enum class CheckKind { MemoryLeak, UseAfterFree, BufferOverflow };
+
+static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<bitcode file>"));
+
+static cl::opt<std::string> OutputPath("o", cl::desc("Report path"), cl::value_desc("file"),
+                                       cl::init("report.sarif"));
+
+static cl::opt<bool> Compact("compact", cl::desc("Write the report without indentation"),
+                             cl::init(false));
+
+static cl::list<CheckKind> Checks(
+    "checks", cl::desc("Checkers to run (default: all)"), cl::CommaSeparated,
+    cl::values(clEnumValN(CheckKind::MemoryLeak, "ml", "Memory leaks"),
+               clEnumValN(CheckKind::UseAfterFree, "uaf", "Use after free"),
+               clEnumValN(CheckKind::BufferOverflow, "bof", "Buffer overflows")));
+
+static cl::opt<unsigned> Threads("j", cl::desc("Threads building function graphs (0 = all cores)"),
+                                 cl::init(1));
+
+static cl::opt<bool> Lazy("lazy", cl::desc("Read only the function bodies reachable from main"),
+                          cl::init(false));
+
+static cl::opt<unsigned> ResidentBudget(
+    "graph-budget",
+    cl::desc("Instructions whose graphs may stay in memory; functions are then "
+             "analyzed bottom-up and cold graphs are rebuilt on demand (0 = no limit)"),
+    cl::init(0));
+
+static cl::opt<bool> DebugLite(
+    "debug-lite", cl::desc("Keep only a line table of the debug info while analyzing"),
+    cl::init(false));
+
+static cl::opt<double> TimeBudget(
+    "time-budget", cl::desc("Seconds the analysis may take; report what was found by then (0 = no limit)"),
+    cl::init(0));
+
+static cl::opt<unsigned> QueryNodeBudget(
+    "query-node-budget", cl::desc("Nodes a single checker query may visit (0 = no limit)"),
+    cl::init(0));
+
+static cl::opt<unsigned> QueryEdgeBudget(
+    "query-edge-budget", cl::desc("Edges a single checker query may follow (0 = no limit)"),
+    cl::init(0));
+
+static cl::opt<std::string> CachePath("cache",
+                                      cl::desc("Reuse findings for unchanged code from this file"),
+                                      cl::value_desc("file"));
+
+static cl::opt<std::string> DaemonAddress(
+    "daemon", cl::desc("Serve analysis requests from analyzer-client on this address "
+                       "(unix:<path> or <host>:<port>)"),
+    cl::value_desc("address"));
+
+static cl::opt<std::string> ProjectPath(
+    "project", cl::desc("Link the bitcode files below a directory (or listed in a file) "
+                        "and analyze them as one program"),
+    cl::value_desc("dir|list"));
+
+static cl::opt<bool> Prescreen(
+    "prescreen", cl::desc("Analyze only the functions that use malloc, free, memcpy, strcpy, "
+                          "snprintf, scanf or arrays, their callers and the functions they pass "
+                          "pointers to; with -project, import only the functions that reach "
+                          "one of those calls, which may miss findings"),
+    cl::init(false));
+
+static cl::opt<bool> Slice(
+    "slice", cl::desc("Build the graphs only over the values connected to calls, comparisons "
+                      "and arrays"),
+    cl::init(false));
+
+static cl::opt<unsigned> InlineThreshold(
+    "inline-helpers", cl::desc("Inline non-recursive functions of at most this many "
+                                 "instructions before analysis (0 = off)"),
+    cl::value_desc("N"), cl::init(0));
+
+static cl::opt<std::string> SummaryDir(
+    "summary-dir", cl::desc("Keep the per-file summaries of -prescreen in this directory"),
+    cl::value_desc("dir"));
+
+static cl::opt<std::string> DiffPath(
+    "diff", cl::desc("Analyze only the functions changed by a patch (unified diff or "
+                     "<file>:<first>-<last> lines) and their callers"),
+    cl::value_desc("file"));
+
+static AnalyzerOptions getAnalyzerOptions() {
+  AnalyzerOptions Options;
+  Options.graphBudget = ResidentBudget;
+  Options.stripDebugInfo = DebugLite;
+  Options.prescreen = Prescreen;
+  Options.slice = Slice;
+  Options.inlineThreshold = InlineThreshold;
+  Options.timeBudget = TimeBudget;
+  Options.queryNodeBudget = QueryNodeBudget;
+  Options.queryEdgeBudget = QueryEdgeBudget;
+  Options.threads = Threads ? Threads.getValue() : std::max(1u, std::thread::hardware_concurrency());
+  if (Checks.empty()) {
+    return Options;
+  }
+  Options.mlCheck = Options.uafCheck = Options.bofCheck = false;
+  for (CheckKind Kind : Checks) {
+    switch (Kind) {
+    case CheckKind::MemoryLeak:Options.mlCheck = true;
+      break;
+    case CheckKind::UseAfterFree:Options.uafCheck = true;
+      break;
+    case CheckKind::BufferOverflow:Options.bofCheck = true;
+      break;
+    }
+  }
+  return Options;
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "bitcode analyzer\n");
+
+  if (!DaemonAddress.empty()) {
+    AnalysisDaemon::Options Opts;
+    Opts.Address = DaemonAddress;
+    Opts.Analysis = getAnalyzerOptions();
+    Opts.LazyLoad = Lazy;
+    Opts.CachePath = CachePath;
+    Opts.Compact = Compact;
+    return AnalysisDaemon(Opts).run() ? 0 : 1;
+  }
+  if (InputFile.empty() == ProjectPath.empty()) {
+    errs() << "error: expected either an input file or -project\n";
+    return 1;
+  }
+
+  LLVMContext Context;
+  std::string Error;
+  std::unique_ptr<Module> M;
+  if (ProjectPath.empty()) {
+    M = parseInput(InputFile, Context, Error, Lazy);
+  } else {
+    std::vector<std::string> Inputs;
+    ProjectLoader::Options LoaderOpts;
+    LoaderOpts.Prescreen = Prescreen;
+    LoaderOpts.SummaryDir = SummaryDir;
+    ProjectLoader Loader(LoaderOpts);
+    if (ProjectLoader::collectInputs(ProjectPath, Inputs, Error)) {
+      M = Loader.load(Inputs, Context, Error);
+    }
+    if (M) {
+      errs() << "linked " << Loader.getLinkedFileCount() << " of " << Inputs.size()
+             << " files";
+      if (Prescreen) {
+        errs() << ", dropped " << Loader.getDroppedFunctionCount() << " function bodies";
+      }
+      errs() << "\n";
+    }
+  }
+  if (!M) {
+    errs() << "error: " << Error << "\n";
+    return 1;
+  }
+
+  AnalyzerOptions Options = getAnalyzerOptions();
+  DiffScope Scope;
+  size_t Changed = 0;
+  if (!DiffPath.empty()) {
+    if (!Scope.load(DiffPath, Error)) {
+      errs() << "error: " << Error << "\n";
+      return 1;
+    }
+    Options.isChanged = [&Scope, &Changed](const Function &F) {
+      bool IsChanged = Scope.isChanged(F);
+      Changed += IsChanged;
+      return IsChanged;
+    };
+  }
+
+  auto Writer = SarifWriter::create(OutputPath, Compact, Error);
+  if (!Writer) {
+    errs() << "error: " << Error << "\n";
+    return 1;
+  }
+
+  // The warning on stderr is the copy of a notification that survives a
+  // crash; the report only gets them when it is finished.
+  Options.onTruncated = [&Writer](const std::string &What) {
+    errs() << "warning: " << What << "\n";
+    Writer->addNotification(What);
+  };
+
+  // Each finding is written as soon as it is found, so it survives a crash
+  // or a timeout in a later check.
+  auto WriteReport = [&Writer](const BugReport &Report) { Writer->addResult(Report); };
+  if (CachePath.empty()) {
+    SimplePass().findBugs(*M, Options, WriteReport);
+  } else {
+    AnalysisCache Cache;
+    Cache.load(CachePath);
+    Cache.findBugs(*M, Options, WriteReport);
+    Cache.save(CachePath);
+  }
+  if (!DiffPath.empty()) {
+    errs() << Scope.getHunkCount() << " hunks change " << Changed
+           << " of the functions reached from main\n";
+  }
+  return 0;
+}
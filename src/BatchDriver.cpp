@@ -0,0 +1,242 @@
+#include "BatchDriver.h"
+#include "BoundedQueue.h"
+#include "SimplePass.h"
+#include "llvm/IRReader/IRReader.h"
+#include <thread>
+#include <unordered_map>
+
+std::unique_ptr<Module> parseInput(const std::string &Path, LLVMContext &Context,
+                                   std::string &Error, bool Lazy) {
+  SMDiagnostic Diag;
+  std::unique_ptr<Module> M =
+      Lazy ? getLazyIRFileModule(Path, Diag, Context) : parseIRFile(Path, Diag, Context);
+  if (!M) {
+    raw_string_ostream OS(Error);
+    Diag.print("analyzer", OS, false);
+    OS.flush();
+    if (Error.empty()) {
+      Error = "cannot parse " + Path;
+    }
+  }
+  return M;
+}
+
+InputResult analyzeFile(const std::string &Path, bool Lazy, AnalysisCache *Cache,
+                        const AnalyzerOptions &Analysis) {
+  InputResult Result;
+  Result.Path = Path;
+
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseInput(Path, Context, Result.Error, Lazy);
+  if (!M) {
+    return Result;
+  }
+
+  Result.Reports = Cache ? Cache->findBugs(*M, Analysis) : SimplePass().findBugs(*M, Analysis);
+  return Result;
+}
+
+BatchDriver::BatchDriver(std::vector<std::string> Inputs, Options Opts)
+    : Inputs(std::move(Inputs)), Opts(std::move(Opts)) {}
+
+AnalyzerOptions BatchDriver::getAnalyzerOptions() const {
+  AnalyzerOptions Analysis;
+  Analysis.stripDebugInfo = Opts.DebugLite;
+  Analysis.prescreen = Opts.Prescreen;
+  Analysis.slice = Opts.Slice;
+  Analysis.inlineThreshold = Opts.InlineThreshold;
+  return Analysis;
+}
+
+/// Give every input a distinct report name derived from its file name.
+void BatchDriver::assignReportPaths() {
+  ReportPaths.clear();
+  if (Opts.OutputDir.empty()) {
+    return;
+  }
+
+  std::unordered_map<std::string, unsigned> Seen;
+  for (const std::string &Input : Inputs) {
+    std::string Stem = std::filesystem::path(Input).stem().string();
+    unsigned Count = Seen[Stem]++;
+    if (Count) {
+      Stem += "-" + std::to_string(Count);
+    }
+    std::filesystem::path Report = Opts.OutputDir;
+    Report /= Stem + ".sarif";
+    ReportPaths.push_back(Report.string());
+  }
+}
+
+void BatchDriver::writeReport(size_t Index) {
+  if (Results[Index].failed()) {
+    errs() << "error: " << Results[Index].Error << "\n";
+  } else if (!ReportPaths.empty()) {
+    std::string Error;
+    if (auto Writer = SarifWriter::create(ReportPaths[Index], Opts.Compact, Error)) {
+      for (const BugReport &Report : Results[Index].Reports) {
+        Writer->addResult(Report);
+      }
+    } else {
+      errs() << "error: " << Error << "\n";
+    }
+  }
+  appendMergedReport(Index);
+}
+
+/// Stream the results of every finished input that directly follows those
+/// already written, so the merged report and the findings log grow in input
+/// order while the batch runs.
+void BatchDriver::appendMergedReport(size_t Index) {
+  if (!MergedWriter && !LogWriter) {
+    return;
+  }
+  std::lock_guard<std::mutex> Lock(MergedMutex);
+  Finished[Index] = true;
+  for (; NextMerged < Results.size() && Finished[NextMerged]; ++NextMerged) {
+    for (const BugReport &Report : Results[NextMerged].Reports) {
+      if (MergedWriter) {
+        MergedWriter->addResult(Report);
+      }
+      if (LogWriter) {
+        LogWriter->add(Results[NextMerged].Path, Report);
+      }
+    }
+  }
+  if (LogWriter) {
+    LogWriter->flush();
+  }
+}
+
+void BatchDriver::worker() {
+  for (size_t I = NextInput++; I < Inputs.size(); I = NextInput++) {
+    Results[I] = analyzeFile(Inputs[I], Opts.LazyLoad, Cache.get(), getAnalyzerOptions());
+    writeReport(I);
+  }
+}
+
+namespace {
+
+/// A module travelling from the parse stage to the analysis stage together
+/// with the context that owns it.
+struct ParsedInput {
+  size_t Index = 0;
+  std::unique_ptr<LLVMContext> Context;
+  std::unique_ptr<Module> M;
+  std::string Error;
+};
+
+} // namespace
+
+/// Run parse -> analyze -> report as separate stages connected by bounded
+/// queues, so that the next module is read while the current one is analyzed
+/// and the previous results are serialized.
+void BatchDriver::runPipeline(unsigned AnalyzeThreads) {
+  BoundedQueue<ParsedInput> Parsed(Opts.QueueDepth);
+  BoundedQueue<size_t> Analyzed(Opts.QueueDepth);
+
+  std::thread Parser([&] {
+    for (size_t I = 0; I < Inputs.size(); ++I) {
+      ParsedInput Item;
+      Item.Index = I;
+      Item.Context = std::make_unique<LLVMContext>();
+      Item.M = parseInput(Inputs[I], *Item.Context, Item.Error, Opts.LazyLoad);
+      if (!Parsed.push(std::move(Item))) {
+        break;
+      }
+    }
+    Parsed.close();
+  });
+
+  std::vector<std::thread> Analyzers;
+  for (unsigned T = 0; T < AnalyzeThreads; ++T) {
+    Analyzers.emplace_back([&] {
+      ParsedInput Item;
+      while (Parsed.pop(Item)) {
+        InputResult &Result = Results[Item.Index];
+        Result.Path = Inputs[Item.Index];
+        Result.Error = Item.Error;
+        if (Item.M) {
+          Result.Reports = Cache ? Cache->findBugs(*Item.M, getAnalyzerOptions())
+                                 : SimplePass().findBugs(*Item.M, getAnalyzerOptions());
+        }
+        // Free the module before its context.
+        Item.M.reset();
+        Item.Context.reset();
+        Analyzed.push(Item.Index);
+      }
+    });
+  }
+
+  std::thread Reporter([&] {
+    size_t Index = 0;
+    while (Analyzed.pop(Index)) {
+      writeReport(Index);
+    }
+  });
+
+  Parser.join();
+  for (std::thread &T : Analyzers) {
+    T.join();
+  }
+  Analyzed.close();
+  Reporter.join();
+}
+
+unsigned BatchDriver::run() {
+  Results.assign(Inputs.size(), {});
+  NextInput = 0;
+  if (!Opts.OutputDir.empty()) {
+    std::filesystem::create_directories(Opts.OutputDir);
+  }
+  assignReportPaths();
+  Finished.assign(Inputs.size(), false);
+  NextMerged = 0;
+  if (!Opts.MergedOutput.empty()) {
+    std::string Error;
+    MergedWriter = SarifWriter::create(Opts.MergedOutput, Opts.Compact, Error);
+    if (!MergedWriter) {
+      errs() << "error: " << Error << "\n";
+    }
+  }
+  if (!Opts.FindingsLog.empty()) {
+    std::string Error;
+    LogWriter = FindingsLogWriter::create(Opts.FindingsLog, Error);
+    if (!LogWriter) {
+      errs() << "error: " << Error << "\n";
+    }
+  }
+  if (!Opts.CachePath.empty()) {
+    Cache = std::make_unique<AnalysisCache>();
+    Cache->load(Opts.CachePath);
+  }
+
+  unsigned NumThreads = std::max(1u, Opts.Threads);
+  NumThreads = std::min<size_t>(NumThreads, std::max<size_t>(1, Inputs.size()));
+
+  if (Opts.Pipeline) {
+    runPipeline(NumThreads);
+  } else {
+    std::vector<std::thread> Workers;
+    for (unsigned I = 1; I < NumThreads; ++I) {
+      Workers.emplace_back(&BatchDriver::worker, this);
+    }
+    worker();
+    for (std::thread &T : Workers) {
+      T.join();
+    }
+  }
+
+  MergedWriter.reset();
+  LogWriter.reset();
+  if (Cache) {
+    errs() << "cache: " << Cache->getHits() << " hit(s), " << Cache->getMisses() << " miss(es)\n";
+    Cache->save(Opts.CachePath);
+  }
+
+  unsigned Failed = 0;
+  for (const InputResult &Result : Results) {
+    Failed += Result.failed();
+  }
+  return Failed;
+}
@@ -0,0 +1,207 @@
+#include "BatchDriver.h"
+#include "Farm.h"
+#include "Supervisor.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+#include <thread>
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::desc("<bitcode files>"));
+
+static cl::opt<std::string> InputList("input-list",
+                                      cl::desc("File with one bitcode path per line"),
+                                      cl::value_desc("file"));
+
+static cl::opt<unsigned> Threads("j", cl::desc("Number of worker threads (0 = all cores)"),
+                                 cl::init(0));
+
+static cl::opt<std::string> OutputDir("output-dir",
+                                      cl::desc("Write one report per input into this directory"),
+                                      cl::value_desc("dir"));
+
+static cl::opt<std::string> MergedOutput("o", cl::desc("Write a merged report for all inputs"),
+                                         cl::value_desc("file"));
+
+static cl::opt<bool> Supervise("supervise",
+                               cl::desc("Analyze inputs in forked worker processes that are "
+                                        "restarted when they crash"));
+
+static cl::opt<unsigned> Timeout("timeout", cl::desc("Wall-clock limit per input in seconds "
+                                                     "(with -supervise)"),
+                                 cl::init(0));
+
+static cl::opt<unsigned> MaxRSS("max-rss", cl::desc("Memory limit per worker in MB "
+                                                    "(with -supervise)"),
+                                cl::init(0));
+
+static cl::opt<std::string> ShardDir("shard-dir",
+                                     cl::desc("Keep per-input results of -supervise here"),
+                                     cl::value_desc("dir"));
+
+static cl::opt<std::string> CoordinatorAddress(
+    "coordinator", cl::desc("Hand the inputs out to remote workers connecting to this address "
+                            "(<host>:<port> or unix:<path>)"),
+    cl::value_desc("address"));
+
+static cl::opt<std::string> WorkerAddress(
+    "worker", cl::desc("Analyze jobs pulled from the coordinator at this address"),
+    cl::value_desc("address"));
+
+static cl::opt<unsigned> HeartbeatTimeout(
+    "heartbeat-timeout", cl::desc("Requeue the job of a worker silent for this many seconds"),
+    cl::init(10));
+
+static cl::opt<unsigned> HeartbeatInterval(
+    "heartbeat-interval", cl::desc("Seconds between heartbeats of a worker"), cl::init(2));
+
+static cl::opt<bool> Pipeline("pipeline",
+                              cl::desc("Parse, analyze and write reports in separate stages"),
+                              cl::init(false));
+
+static cl::opt<unsigned> QueueDepth("queue-depth",
+                                    cl::desc("Modules buffered between pipeline stages"),
+                                    cl::init(4));
+
+static cl::opt<bool> Lazy("lazy", cl::desc("Read only the function bodies reachable from main"),
+                          cl::init(false));
+
+static cl::opt<std::string> CachePath("cache",
+                                      cl::desc("Reuse findings for unchanged modules from this file"),
+                                      cl::value_desc("file"));
+
+static cl::opt<std::string> FindingsLog(
+    "findings-log", cl::desc("Also write all findings to a binary log (see analyzer-findings)"),
+    cl::value_desc("file"));
+
+static cl::opt<bool> Prescreen(
+    "prescreen", cl::desc("Analyze only the functions that use malloc, free, memcpy, strcpy, "
+                          "snprintf, scanf or arrays, their callers and the functions they pass "
+                          "pointers to"),
+    cl::init(false));
+
+static cl::opt<bool> Slice(
+    "slice", cl::desc("Build the graphs only over the values connected to calls, comparisons "
+                      "and arrays"),
+    cl::init(false));
+
+static cl::opt<unsigned> InlineThreshold(
+    "inline-helpers", cl::desc("Inline non-recursive functions of at most this many "
+                                 "instructions before analysis (0 = off)"),
+    cl::value_desc("N"), cl::init(0));
+
+static cl::opt<bool> DebugLite(
+    "debug-lite", cl::desc("Keep only a line table of the debug info while analyzing"),
+    cl::init(false));
+
+static cl::opt<bool> Compact("compact", cl::desc("Write reports without indentation"),
+                             cl::init(false));
+
+static bool readInputList(const std::string &Path, std::vector<std::string> &Inputs) {
+  auto Buffer = MemoryBuffer::getFile(Path);
+  if (!Buffer) {
+    errs() << "error: cannot read " << Path << ": " << Buffer.getError().message() << "\n";
+    return false;
+  }
+  for (line_iterator Line(**Buffer, true), End; Line != End; ++Line) {
+    Inputs.push_back(Line->trim().str());
+  }
+  return true;
+}
+
+/// Analysis options for the inputs handed to worker processes.
+static AnalyzerOptions getAnalyzerOptions() {
+  AnalyzerOptions Analysis;
+  Analysis.stripDebugInfo = DebugLite;
+  Analysis.prescreen = Prescreen;
+  Analysis.slice = Slice;
+  Analysis.inlineThreshold = InlineThreshold;
+  return Analysis;
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "batch bitcode analyzer\n");
+
+  if (!WorkerAddress.empty()) {
+    FarmWorker::Options Opts;
+    Opts.Address = WorkerAddress;
+    Opts.HeartbeatIntervalSec = HeartbeatInterval;
+    return FarmWorker(Opts).run() < 0 ? 1 : 0;
+  }
+
+  std::vector<std::string> Inputs(InputFiles.begin(), InputFiles.end());
+  if (!InputList.empty() && !readInputList(InputList, Inputs)) {
+    return 1;
+  }
+  if (Inputs.empty()) {
+    errs() << "error: no input files\n";
+    return 1;
+  }
+
+  if (!CoordinatorAddress.empty()) {
+    Coordinator::Options Opts;
+    Opts.Address = CoordinatorAddress;
+    Opts.HeartbeatTimeoutSec = HeartbeatTimeout;
+    Opts.Compact = Compact;
+    Opts.FindingsLog = FindingsLog;
+    Opts.Analysis = getAnalyzerOptions();
+    Opts.LazyLoad = Lazy;
+    if (!MergedOutput.empty() || !FindingsLog.empty()) {
+      Opts.MergedOutput = MergedOutput;
+    }
+    int Failed = Coordinator(std::move(Inputs), Opts).run();
+    if (Failed > 0) {
+      errs() << Failed << " input(s) could not be analyzed\n";
+    }
+    return Failed ? 1 : 0;
+  }
+
+  unsigned NumThreads = Threads ? Threads : std::thread::hardware_concurrency();
+
+  if (Supervise) {
+    Supervisor::Options Opts;
+    Opts.Workers = NumThreads;
+    Opts.TimeoutSec = Timeout;
+    Opts.MaxRSSMB = MaxRSS;
+    Opts.ShardDir = ShardDir;
+    Opts.Compact = Compact;
+    Opts.FindingsLog = FindingsLog;
+    Opts.Analysis = getAnalyzerOptions();
+    Opts.LazyLoad = Lazy;
+    if (!MergedOutput.empty() || !FindingsLog.empty()) {
+      Opts.MergedOutput = MergedOutput;
+    }
+    unsigned Failed = Supervisor(std::move(Inputs), Opts).run();
+    if (Failed) {
+      errs() << Failed << " input(s) could not be analyzed\n";
+    }
+    return Failed ? 1 : 0;
+  }
+
+  BatchDriver::Options Opts;
+  Opts.Threads = NumThreads;
+  Opts.OutputDir = OutputDir;
+  Opts.MergedOutput = MergedOutput;
+  Opts.FindingsLog = FindingsLog;
+  Opts.Pipeline = Pipeline;
+  Opts.LazyLoad = Lazy;
+  Opts.CachePath = CachePath;
+  Opts.Compact = Compact;
+  Opts.DebugLite = DebugLite;
+  Opts.Prescreen = Prescreen;
+  Opts.Slice = Slice;
+  Opts.InlineThreshold = InlineThreshold;
+  Opts.QueueDepth = std::max(1u, unsigned(QueueDepth));
+  if (Opts.OutputDir.empty() && Opts.MergedOutput.empty() && Opts.FindingsLog.empty()) {
+    Opts.MergedOutput = "report.sarif";
+  }
+
+  BatchDriver Driver(std::move(Inputs), Opts);
+  unsigned Failed = Driver.run();
+  if (Failed) {
+    errs() << Failed << " input(s) could not be analyzed\n";
+  }
+  return Failed ? 1 : 0;
+}
@@ -5,25 +5,93 @@ namespace llvm {
 Checker::Checker(const std::unordered_map<Function *, std::shared_ptr<FuncInfo>> &info)
     : funcInfos(info) {}
 
-bool Checker::IsLibraryFunction(Value *val) {
-  if (!isa<Instruction>(val)) {
+void Checker::SetBudget(const QueryBudget &queryBudget) {
+  budget = queryBudget;
+}
+
+size_t Checker::GetStoppedQueries() const {
+  return stoppedQueries;
+}
+
+const std::string &Checker::GetStopReason() const {
+  return stopReason;
+}
+
+void Checker::BeginQuery() {
+  if (queryDepth++) {
+    return;
+  }
+  queryNodes = 0;
+  queryEdges = 0;
+  queryStopped = false;
+}
+
+void Checker::EndQuery() {
+  if (--queryDepth == 0 && queryStopped) {
+    ++stoppedQueries;
+  }
+}
+
+// The clock is read every 256 nodes only.
+bool Checker::ChargeQuery(size_t edges) {
+  if (queryStopped) {
     return false;
   }
-  auto *inst = dyn_cast<Instruction>(val);
-  for (const std::string &name : libraryCalls) {
-    if (IsCallWithName(inst, name)) {
-      return true;
-    }
+  ++queryNodes;
+  queryEdges += edges;
+  if (budget.nodes && queryNodes > budget.nodes) {
+    stopReason = "node budget of " + std::to_string(budget.nodes) + " exceeded";
+  } else if (budget.edges && queryEdges > budget.edges) {
+    stopReason = "edge budget of " + std::to_string(budget.edges) + " exceeded";
+  } else if ((queryNodes == 1 || queryNodes % 256 == 0) && budget.OutOfTime()) {
+    stopReason = "time budget exhausted";
+  } else {
+    return true;
   }
+  queryStopped = true;
   return false;
 }
 
+const StringSet<> &Checker::GetLibraryCalls() {
+  static const StringSet<> libraryCalls = {CallInstruction::Memcpy,
+                                           CallInstruction::Strlen,
+                                           CallInstruction::Scanf,
+                                           CallInstruction::Malloc,
+                                           CallInstruction::Free,
+                                           CallInstruction::Time,
+                                           CallInstruction::Srand,
+                                           CallInstruction::Rand,
+                                           CallInstruction::Printf,
+                                           CallInstruction::Snprintf,
+                                           CallInstruction::Memset,
+                                           CallInstruction::Strcpy,
+                                           CallInstruction::Fopen,
+                                           CallInstruction::Fprint,
+  };
+  return libraryCalls;
+}
+
+bool Checker::IsLibraryFunction(Value *val) {
+  auto *call = dyn_cast<CallInst>(val);
+  if (!call || !call->getCalledFunction()) {
+    return false;
+  }
+  return GetLibraryCalls().count(call->getCalledFunction()->getName());
+}
+
+bool Checker::HasFuncInfo(Function *function) const {
+  auto it = funcInfos.find(function);
+  return it != funcInfos.end() && it->second;
+}
+
 DFSResult Checker::DFSTraverse(Function *function, const DFSContext &context,
                                std::unordered_set<Value *> &visitedNodes) {
 
   DFSResult result;
 
   FuncInfo *funcInfo = funcInfos[function].get();
+  // Callees traversed below must not release the graph held here.
+  FuncInfoPin pin(funcInfo);
   auto *map = funcInfo->SelectMap(context.mapID);
   std::stack<Value *> dfsStack;
   dfsStack.push(context.start);
@@ -34,6 +102,9 @@ DFSResult Checker::DFSTraverse(Function *function, const DFSContext &context,
   while (!dfsStack.empty()) {
     Value *current = dfsStack.top();
     dfsStack.pop();
+    if (!ChargeQuery(map->operator[](current).size())) {
+      break;
+    }
 
     result.path.push_back(current);
     tmpPath = result.path;
@@ -90,7 +161,7 @@ DFSResult Checker::DFSTraverse(Function *function, const DFSContext &context,
       // Handle call instruction
       Function *calledFunction = callInst->getCalledFunction();
       if (calledFunction && !calledFunction->isDeclarationForLinker() &&
-          !IsLibraryFunction(current)) {
+          !IsLibraryFunction(current) && HasFuncInfo(calledFunction)) {
 
         Value *nextStart = nullptr;
         if (context.mapID == AnalyzerMap::ForwardFlowMap) {
@@ -115,7 +186,7 @@ DFSResult Checker::DFSTraverse(Function *function, const DFSContext &context,
           // Process results
           result.combine(calledFunctionResult, calledFunction->getName().str());
 
-          if (calledFunctionResult.status) {
+          if (calledFunctionResult.status || queryStopped) {
              return result;
           }
         }
@@ -155,7 +226,10 @@ DFSResult Checker::DFSTraverse(Function *function, const DFSContext &context,
 DFSResult Checker::DFS(const DFSContext &context) {
   std::unordered_set<Value *> visitedNodes;
   Function *function = dyn_cast<Instruction>(context.start)->getFunction();
-  return DFSTraverse(function, context, visitedNodes);
+  BeginQuery();
+  DFSResult result = DFSTraverse(function, context, visitedNodes);
+  EndQuery();
+  return result;
 }
 
 size_t Checker::CalculNumOfArg(llvm::CallInst *cInst,
@@ -178,7 +252,9 @@ void Checker::CollectPaths(Instruction *from, Instruction *to,
   std::unordered_set<Value *> visitedNodes;
   std::vector<Value *> currentPath;
   Function *function = from->getFunction();
+  BeginQuery();
   FindPaths(visitedNodes, allPaths, currentPath, from, to, function);
+  EndQuery();
 }
 
 // Todo: add support of other maps
@@ -192,6 +268,11 @@ void Checker::FindPaths(std::unordered_set<Value *> &visitedNodes,
   if (visitedNodes.find(from) != visitedNodes.end()) {
     return;
   }
+  FuncInfo *funcInfo = funcInfos[function].get();
+  ValueSet &successors = funcInfo->SelectMap(AnalyzerMap::ForwardFlowMap)->operator[](from);
+  if (!ChargeQuery(successors.size())) {
+    return;
+  }
   visitedNodes.insert(from);
   currentPath.push_back(from);
 
@@ -202,9 +283,7 @@ void Checker::FindPaths(std::unordered_set<Value *> &visitedNodes,
     return;
   }
 
-  FuncInfo *funcInfo = funcInfos[function].get();
-
-  for (Value *next : funcInfo->SelectMap(AnalyzerMap::ForwardFlowMap)->operator[](from)) {
+  for (Value *next : successors) {
     FindPaths(visitedNodes, paths, currentPath, next, to, function);
   }
   currentPath.pop_back();
@@ -0,0 +1,47 @@
+#include "Daemon.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/raw_ostream.h"
+
+static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<bitcode file>"));
+
+static cl::opt<std::string> Address("socket", cl::desc("Address of the analyzer daemon"),
+                                    cl::value_desc("address"), cl::init("unix:/tmp/analyzer.sock"));
+
+static cl::opt<std::string> OutputPath("o", cl::desc("Report path ('-' for stdout)"),
+                                       cl::value_desc("file"), cl::init("report.sarif"));
+
+static cl::opt<bool> Shutdown("shutdown", cl::desc("Stop the daemon"), cl::init(false));
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "analyzer daemon client\n");
+
+  std::string Error;
+  if (Shutdown) {
+    if (!requestShutdown(Address, Error)) {
+      errs() << "error: " << Error << "\n";
+      return 1;
+    }
+    return 0;
+  }
+  if (InputFile.empty()) {
+    errs() << "error: no input file\n";
+    return 1;
+  }
+
+  std::string Report;
+  if (!requestAnalysis(Address, InputFile, Report, Error)) {
+    errs() << "error: " << Error << "\n";
+    return 1;
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(OutputPath, EC);
+  if (EC) {
+    errs() << "error: cannot write " << OutputPath << ": " << EC.message() << "\n";
+    return 1;
+  }
+  OS << Report;
+  return 0;
+}
@@ -0,0 +1,161 @@
+#include "ClonedModule.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include <unordered_set>
+
+namespace llvm {
+
+ClonedModule::ClonedModule(const Module &module, const std::vector<Function *> &functions) {
+  std::unordered_set<const GlobalValue *> cloned(functions.begin(), functions.end());
+  clone = CloneModule(module, valueMap, [&cloned](const GlobalValue *global) {
+    return !isa<Function>(global) || cloned.count(global);
+  });
+  for (const auto &entry : valueMap) {
+    Value *copy = entry.second;
+    if (copy && (isa<Instruction>(copy) || isa<Argument>(copy) || isa<GlobalValue>(copy))) {
+      handles.push_back({const_cast<Value *>(entry.first), WeakVH(copy), WeakTrackingVH(copy)});
+    }
+  }
+  MapBack();
+}
+
+Module &ClonedModule::GetModule() {
+  return *clone;
+}
+
+Function *ClonedModule::GetClone(const Function *original) const {
+  return cast_or_null<Function>(valueMap.lookup(original));
+}
+
+// InlineFunction gives no map of what it copied. Instead, the instructions
+// of the callees are tagged with the index of their original first; the
+// copies keep the tags, also when a callee was itself inlined into another.
+void ClonedModule::InlineSmallFunctions(size_t threshold) {
+  std::unordered_set<Function *> recursive;
+  CallGraph callGraph(*clone);
+  for (auto scc = scc_begin(&callGraph); !scc.isAtEnd(); ++scc) {
+    if (!scc.hasCycle()) {
+      continue;
+    }
+    for (CallGraphNode *node : *scc) {
+      if (Function *function = node->getFunction()) {
+        recursive.insert(function);
+      }
+    }
+  }
+
+  std::unordered_set<Function *> small;
+  for (Function &function : *clone) {
+    if (function.isDeclaration() || recursive.count(&function) || function.getName() == "main") {
+      continue;
+    }
+    size_t size = 0;
+    for (Instruction &inst : instructions(function)) {
+      size += !inst.isDebugOrPseudoInst();
+    }
+    if (size <= threshold) {
+      small.insert(&function);
+    }
+  }
+  if (small.empty()) {
+    return;
+  }
+
+  LLVMContext &context = clone->getContext();
+  unsigned tagKind = context.getMDKindID("analyzer.origin");
+  std::vector<std::pair<Instruction *, Value *>> tagged;
+  for (Function *function : small) {
+    for (Instruction &inst : instructions(function)) {
+      Value *original = GetOriginal(&inst);
+      if (!original) {
+        continue;
+      }
+      Metadata *index = ConstantAsMetadata::get(ConstantInt::get(Type::getInt64Ty(context), tagged.size()));
+      inst.setMetadata(tagKind, MDNode::get(context, index));
+      tagged.emplace_back(&inst, original);
+    }
+  }
+
+  std::vector<CallBase *> calls;
+  for (Function &function : *clone) {
+    for (Instruction &inst : instructions(function)) {
+      auto *call = dyn_cast<CallBase>(&inst);
+      if (call && call->getCalledFunction() && small.count(call->getCalledFunction())) {
+        calls.push_back(call);
+      }
+    }
+  }
+  // Calls copied out of an inlined body are inlined in turn.
+  while (!calls.empty()) {
+    CallBase *call = calls.back();
+    calls.pop_back();
+    InlineFunctionInfo info;
+    if (!InlineFunction(*call, info).isSuccess()) {
+      continue;
+    }
+    for (CallBase *inlined : info.InlinedCallSites) {
+      if (inlined->getCalledFunction() && small.count(inlined->getCalledFunction())) {
+        calls.push_back(inlined);
+      }
+    }
+  }
+
+  for (Function &function : *clone) {
+    for (Instruction &inst : instructions(function)) {
+      MDNode *tag = inst.getMetadata(tagKind);
+      if (!tag) {
+        continue;
+      }
+      uint64_t index = mdconst::extract<ConstantInt>(tag->getOperand(0))->getZExtValue();
+      if (tagged[index].first != &inst) {
+        handles.push_back({tagged[index].second, WeakVH(&inst), WeakTrackingVH(&inst)});
+      }
+      inst.setMetadata(tagKind, nullptr);
+    }
+  }
+  MapBack();
+}
+
+// A copy that survived stands for its own original. A replacement, such as
+// the value an inlined call returned, stands for the first original it
+// replaced unless it has one of its own.
+void ClonedModule::MapBack() {
+  originals.clear();
+  for (const Handle &entry : handles) {
+    if (entry.handle) {
+      originals[entry.handle] = entry.original;
+    }
+  }
+  for (const Handle &entry : handles) {
+    Value *replacement = entry.replacement;
+    if (replacement && (!isa<Constant>(replacement) || isa<GlobalValue>(replacement))) {
+      originals.emplace(replacement, entry.original);
+    }
+  }
+}
+
+Value *ClonedModule::GetOriginal(Value *value) const {
+  if (!value) {
+    return nullptr;
+  }
+  auto it = originals.find(value);
+  if (it != originals.end()) {
+    return it->second;
+  }
+  auto *inst = dyn_cast<Instruction>(value);
+  if (!inst) {
+    return nullptr;
+  }
+  for (Instruction *next = inst->getNextNode(); next; next = next->getNextNode()) {
+    it = originals.find(next);
+    if (it != originals.end()) {
+      return it->second;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace llvm
@@ -0,0 +1,128 @@
+#include "Daemon.h"
+#include "BatchDriver.h"
+#include <algorithm>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+/// The time budget counts from Received, so parsing and linking are part of
+/// it as they are for a request's caller.
+std::string AnalysisDaemon::analyze(const std::string &Path, Clock::time_point Received, bool &Ok) {
+  LLVMContext Context;
+  std::string Error;
+  std::unique_ptr<Module> M = parseInput(Path, Context, Error, Opts.LazyLoad);
+  Ok = M != nullptr;
+  if (!Ok) {
+    return Error;
+  }
+
+  std::string Report;
+  raw_string_ostream OS(Report);
+  {
+    SarifWriter Writer(OS, Opts.Compact);
+    AnalyzerOptions Analysis = Opts.Analysis;
+    Analysis.budgetStart = Received;
+    Analysis.onTruncated = [&Writer](const std::string &What) { Writer.addNotification(What); };
+    for (const BugReport &Result : Cache.findBugs(*M, Analysis)) {
+      Writer.addResult(Result);
+    }
+  }
+
+  if (!Opts.CachePath.empty()) {
+    std::lock_guard<std::mutex> Lock(SaveMutex);
+    size_t Misses = Cache.getMisses();
+    if (Misses != SavedMisses) {
+      SavedMisses = Misses;
+      Cache.save(Opts.CachePath);
+    }
+  }
+  return OS.str();
+}
+
+/// Answer the requests of one client until it disconnects.
+void AnalysisDaemon::serve(int Fd) {
+  MessageStream Stream(Fd);
+  Message Msg;
+  while (Stream.receive(Msg)) {
+    Clock::time_point Received = Clock::now();
+    if (Msg.getCommand() == DaemonCommand::Shutdown) {
+      Stopping = true;
+      Stream.send({DaemonCommand::Result, "ok"});
+      return;
+    }
+    if (Msg.getCommand() != DaemonCommand::Analyze) {
+      Stream.send({DaemonCommand::Result, "error"}, "unknown command");
+      continue;
+    }
+    bool Ok = false;
+    std::string Reply = analyze(Msg.Payload, Received, Ok);
+    Stream.send({DaemonCommand::Result, Ok ? "ok" : "error"}, Reply);
+  }
+}
+
+bool AnalysisDaemon::run() {
+  std::string Error;
+  int ListenFd = listenOn(Opts.Address, Error);
+  if (ListenFd < 0) {
+    errs() << "error: cannot listen on " << Opts.Address << ": " << Error << "\n";
+    return false;
+  }
+  if (!Opts.CachePath.empty()) {
+    Cache.load(Opts.CachePath);
+  }
+
+  // A client's thread closes its own descriptor; Fd stays open here until the
+  // thread is joined, so the shutdown() below cannot hit a reused number.
+  struct Client {
+    std::thread Thread;
+    std::shared_ptr<std::atomic<bool>> Done;
+    int Fd;
+  };
+  std::vector<Client> Clients;
+  while (!Stopping) {
+    pollfd Fd = {ListenFd, POLLIN, 0};
+    if (::poll(&Fd, 1, 500) > 0) {
+      int ClientFd = accept(ListenFd, nullptr, nullptr);
+      int ServeFd = ClientFd >= 0 ? dup(ClientFd) : -1;
+      if (ServeFd >= 0) {
+        auto Done = std::make_shared<std::atomic<bool>>(false);
+        Clients.push_back({std::thread([this, ServeFd, Done] {
+                             serve(ServeFd);
+                             *Done = true;
+                           }),
+                           Done, ClientFd});
+      } else if (ClientFd >= 0) {
+        close(ClientFd);
+      }
+    }
+
+    // Join the threads of clients that have gone away.
+    for (Client &C : Clients) {
+      if (*C.Done && C.Thread.joinable()) {
+        C.Thread.join();
+        close(C.Fd);
+      }
+    }
+    Clients.erase(std::remove_if(Clients.begin(), Clients.end(),
+                                 [](const Client &C) { return !C.Thread.joinable(); }),
+                  Clients.end());
+  }
+
+  close(ListenFd);
+  // Clients still connected are blocked in receive; end their side of the
+  // connection so their threads return. Shutting down only the read side
+  // still lets a request in progress be answered.
+  for (Client &C : Clients) {
+    shutdown(C.Fd, SHUT_RD);
+  }
+  for (Client &C : Clients) {
+    C.Thread.join();
+    close(C.Fd);
+  }
+  if (Opts.Address.rfind("unix:", 0) == 0) {
+    // sys::fs::remove refuses to delete sockets.
+    unlink(Opts.Address.c_str() + 5);
+  }
+  return true;
+}
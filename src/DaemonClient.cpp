@@ -0,0 +1,51 @@
+#include "Daemon.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
+const std::string DaemonCommand::Analyze = "ANALYZE";
+const std::string DaemonCommand::Result = "RESULT";
+const std::string DaemonCommand::Shutdown = "SHUTDOWN";
+
+namespace {
+
+bool roundTrip(StringRef Address, const std::vector<std::string> &Args, StringRef Payload,
+               Message &Reply, std::string &Error) {
+  int Fd = connectTo(Address, Error);
+  if (Fd < 0) {
+    Error = "cannot connect to " + Address.str() + ": " + Error;
+    return false;
+  }
+  MessageStream Stream(Fd);
+  if (!Stream.send(Args, Payload) || !Stream.receive(Reply)) {
+    Error = "connection to " + Address.str() + " lost";
+    return false;
+  }
+  if (Reply.getCommand() != DaemonCommand::Result || Reply.Args.size() != 2) {
+    Error = "unexpected reply from " + Address.str();
+    return false;
+  }
+  if (Reply.Args[1] != "ok") {
+    Error = Reply.Payload;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+bool requestAnalysis(StringRef Address, const std::string &Path, std::string &Report,
+                     std::string &Error) {
+  SmallString<256> AbsolutePath(Path);
+  sys::fs::make_absolute(AbsolutePath);
+  Message Reply;
+  if (!roundTrip(Address, {DaemonCommand::Analyze}, AbsolutePath, Reply, Error)) {
+    return false;
+  }
+  Report = std::move(Reply.Payload);
+  return true;
+}
+
+bool requestShutdown(StringRef Address, std::string &Error) {
+  Message Reply;
+  return roundTrip(Address, {DaemonCommand::Shutdown}, "", Reply, Error);
+}
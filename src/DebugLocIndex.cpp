@@ -0,0 +1,78 @@
+#include "DebugLocIndex.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include <filesystem>
+
+DebugLocIndex::DebugLocIndex(const Module &M, bool RecordLines) : M(M) {
+  for (const GlobalVariable &Global : M.globals()) {
+    if (auto *Expr = dyn_cast_or_null<DIGlobalVariableExpression>(Global.getMetadata("dbg"))) {
+      if (DIGlobalVariable *Variable = Expr->getVariable()) {
+        GlobalLines[&Global] = Variable->getLine();
+      }
+    }
+  }
+
+  // Functions of one translation unit mostly share a DIFile; build its URI once.
+  DenseMap<const DIFile *, std::string> FileUriCache;
+  for (const Function &F : M) {
+    bool HasUri = false;
+    for (const Instruction &I : instructions(F)) {
+      if (auto *Declare = dyn_cast<DbgDeclareInst>(&I)) {
+        if (auto *Address = dyn_cast_or_null<Instruction>(Declare->getAddress())) {
+          DeclareLines.try_emplace(Address, Declare->getDebugLoc().getLine());
+        }
+      }
+      const DILocation *Location = I.getDebugLoc();
+      if (!Location) {
+        continue;
+      }
+      // Debug intrinsics go away with the debug info.
+      if (RecordLines && !isa<DbgInfoIntrinsic>(I)) {
+        InstructionLines[&I] = Location->getLine();
+      }
+      if (!HasUri) {
+        auto Inserted = FileUriCache.try_emplace(Location->getFile());
+        if (Inserted.second) {
+          Inserted.first->second = makeFileUri(Location);
+        }
+        FileUris[&F] = Inserted.first->second;
+        HasUri = true;
+      }
+    }
+  }
+}
+
+std::string DebugLocIndex::makeFileUri(const DILocation *Location) {
+  std::filesystem::path FilePathWithPrefix = std::filesystem::path("file://");
+  std::filesystem::path FilePath = Location->getFilename().str();
+  if (FilePath.is_absolute()) {
+    FilePathWithPrefix /= FilePath;
+    return FilePathWithPrefix.string();
+  }
+  std::filesystem::path Directory = Location->getDirectory().str();
+  Directory /= FilePath;
+  FilePathWithPrefix += Directory;
+  return FilePathWithPrefix.string();
+}
+
+unsigned DebugLocIndex::getLine(const Value *V) const {
+  if (auto *Inst = dyn_cast<Instruction>(V)) {
+    if (const DILocation *Location = Inst->getDebugLoc()) {
+      return Location->getLine();
+    }
+    auto Recorded = InstructionLines.find(Inst);
+    if (Recorded != InstructionLines.end()) {
+      return Recorded->second;
+    }
+    auto It = DeclareLines.find(Inst);
+    return It != DeclareLines.end() ? It->second : -1;
+  }
+  auto It = GlobalLines.find(V);
+  return It != GlobalLines.end() ? It->second : -1;
+}
+
+const std::string &DebugLocIndex::getFileUri(const Function *F) const {
+  static const std::string None;
+  auto It = FileUris.find(F);
+  return It != FileUris.end() ? It->second : None;
+}
@@ -0,0 +1,148 @@
+#include "DiffScope.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+
+namespace {
+
+/// Path of a debug info file, made comparable with the paths of a diff.
+std::string debugPath(const DIFile *File) {
+  SmallString<256> Path(File->getFilename());
+  if (!sys::path::is_absolute(Path)) {
+    Path = File->getDirectory();
+    sys::path::append(Path, File->getFilename());
+  }
+  sys::path::remove_dots(Path, true);
+  return Path.str().str();
+}
+
+bool matchesFile(StringRef DebugPath, StringRef HunkPath) {
+  if (!DebugPath.endswith(HunkPath)) {
+    return false;
+  }
+  return DebugPath.size() == HunkPath.size() ||
+         DebugPath[DebugPath.size() - HunkPath.size() - 1] == '/';
+}
+
+} // namespace
+
+bool DiffScope::load(const std::string &Path, std::string &Error) {
+  auto Buffer = MemoryBuffer::getFileOrSTDIN(Path);
+  if (!Buffer) {
+    Error = "cannot read " + Path + ": " + Buffer.getError().message();
+    return false;
+  }
+  StringRef Text = (*Buffer)->getBuffer();
+  if (Text.startswith("@@ ") || Text.contains("\n@@ ")) {
+    return parseUnifiedDiff(Text, Error);
+  }
+  return parseLineList(Text, Error);
+}
+
+/// Take the line ranges of the new side of every hunk: "+++ b/<file>" names the
+/// file and "@@ -a,b +c,d @@" covers lines c to c+d-1.
+bool DiffScope::parseUnifiedDiff(StringRef Text, std::string &Error) {
+  std::string File;
+  SmallVector<StringRef, 0> Lines;
+  Text.split(Lines, '\n');
+  for (StringRef Line : Lines) {
+    Line = Line.rtrim("\r");
+    if (Line.startswith("+++ ")) {
+      StringRef Name = Line.drop_front(4).split('\t').first.trim();
+      if (Name == "/dev/null") {
+        File.clear();
+      } else {
+        Name.consume_front("b/");
+        File = Name.str();
+      }
+      continue;
+    }
+    if (!Line.startswith("@@ ") || File.empty()) {
+      continue;
+    }
+
+    SmallVector<StringRef, 4> Fields;
+    Line.split(Fields, ' ', 3, false);
+    unsigned First = 0, Count = 1;
+    if (Fields.size() < 3 || !Fields[2].consume_front("+")) {
+      Error = "malformed hunk header: " + Line.str();
+      return false;
+    }
+    auto Range = Fields[2].split(',');
+    if (Range.first.getAsInteger(10, First) ||
+        (!Range.second.empty() && Range.second.getAsInteger(10, Count))) {
+      Error = "malformed hunk header: " + Line.str();
+      return false;
+    }
+    // A hunk that only deletes lines has Count 0 and starts at the line
+    // before the deletion; the function containing that line changed.
+    Hunks.push_back({File, std::max(First, 1u), std::max(First, 1u) + std::max(Count, 1u) - 1});
+  }
+  return true;
+}
+
+bool DiffScope::parseLineList(StringRef Text, std::string &Error) {
+  SmallVector<StringRef, 0> Lines;
+  Text.split(Lines, '\n', -1, false);
+  for (StringRef Line : Lines) {
+    Line = Line.trim();
+    if (Line.empty() || Line.startswith("#")) {
+      continue;
+    }
+    auto FileAndRange = Line.rsplit(':');
+    auto Range = FileAndRange.second.split('-');
+    unsigned First = 0, Last = 0;
+    bool Valid = !FileAndRange.first.empty() && !Range.first.getAsInteger(10, First);
+    Last = First;
+    if (Valid && !Range.second.empty()) {
+      Valid = !Range.second.getAsInteger(10, Last);
+    }
+    if (!Valid || Last < First) {
+      Error = "expected <file>:<first>[-<last>], got: " + Line.str();
+      return false;
+    }
+    Hunks.push_back({FileAndRange.first.str(), First, Last});
+  }
+  return true;
+}
+
+bool DiffScope::isChanged(const Function &F) const {
+  auto HunksOf = [this](const DIFile *File) -> const std::vector<const Hunk *> & {
+    auto It = FileHunks.find(File);
+    if (It != FileHunks.end()) {
+      return It->second;
+    }
+    std::vector<const Hunk *> &Matching = FileHunks[File];
+    std::string Path = debugPath(File);
+    for (const Hunk &H : Hunks) {
+      if (matchesFile(Path, H.File)) {
+        Matching.push_back(&H);
+      }
+    }
+    return Matching;
+  };
+  auto IsChanged = [&HunksOf](const DIFile *File, unsigned Line) {
+    if (!File) {
+      return false;
+    }
+    for (const Hunk *H : HunksOf(File)) {
+      if (H->First <= Line && Line <= H->Last) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  if (DISubprogram *SP = F.getSubprogram()) {
+    if (IsChanged(SP->getFile(), SP->getLine())) {
+      return true;
+    }
+  }
+  for (const Instruction &I : instructions(F)) {
+    const DILocation *Loc = I.getDebugLoc();
+    if (Loc && IsChanged(Loc->getFile(), Loc->getLine())) {
+      return true;
+    }
+  }
+  return false;
+}
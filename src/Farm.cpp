@@ -0,0 +1,301 @@
+#include "Farm.h"
+#include "llvm/Support/FileSystem.h"
+#include <atomic>
+#include <condition_variable>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+const std::string FarmCommand::Next = "NEXT";
+const std::string FarmCommand::Heartbeat = "HEARTBEAT";
+const std::string FarmCommand::Result = "RESULT";
+const std::string FarmCommand::Job = "JOB";
+const std::string FarmCommand::Wait = "WAIT";
+const std::string FarmCommand::Bye = "BYE";
+
+namespace {
+
+/// Append the options a worker needs to analyze a job like the coordinator's
+/// command line says.
+void appendJobOptions(std::vector<std::string> &Args, const AnalyzerOptions &Analysis, bool Lazy) {
+  Args.push_back("lazy=" + std::to_string(Lazy));
+  Args.push_back("debug-lite=" + std::to_string(Analysis.stripDebugInfo));
+  Args.push_back("prescreen=" + std::to_string(Analysis.prescreen));
+  Args.push_back("slice=" + std::to_string(Analysis.slice));
+  Args.push_back("inline-helpers=" + std::to_string(Analysis.inlineThreshold));
+}
+
+/// Read the options of a JOB message. Options this worker does not know are
+/// ignored.
+bool parseJobOptions(ArrayRef<std::string> Args, AnalyzerOptions &Analysis, bool &Lazy) {
+  for (StringRef Arg : Args) {
+    auto [Name, Value] = Arg.split('=');
+    uint64_t Number = 0;
+    if (Value.getAsInteger(10, Number)) {
+      return false;
+    }
+    if (Name == "lazy") {
+      Lazy = Number;
+    } else if (Name == "debug-lite") {
+      Analysis.stripDebugInfo = Number;
+    } else if (Name == "prescreen") {
+      Analysis.prescreen = Number;
+    } else if (Name == "slice") {
+      Analysis.slice = Number;
+    } else if (Name == "inline-helpers") {
+      Analysis.inlineThreshold = Number;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+Coordinator::Coordinator(std::vector<std::string> Inputs, Options Opts)
+    : Inputs(std::move(Inputs)), Opts(std::move(Opts)) {}
+
+bool Coordinator::isFinished() const {
+  for (JobStatus S : Statuses) {
+    if (S == JobStatus::Queued || S == JobStatus::Running) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Forget a worker and put its job back at the front of the queue.
+void Coordinator::dropConnection(Connection &C, StringRef Reason) {
+  if (C.Job >= 0) {
+    size_t Job = static_cast<size_t>(C.Job);
+    errs() << "worker lost (" << Reason << ") while analyzing " << Inputs[Job] << "\n";
+    if (Statuses[Job] == JobStatus::Running) {
+      if (++Attempts[Job] >= Opts.MaxAttempts) {
+        errs() << "error: " << Inputs[Job] << ": giving up after " << Attempts[Job]
+               << " lost workers\n";
+        Statuses[Job] = JobStatus::Failed;
+      } else {
+        Statuses[Job] = JobStatus::Queued;
+        Queue.push_front(Job);
+      }
+    }
+    C.Job = -1;
+  }
+  C.Stream->close();
+}
+
+void Coordinator::handle(Connection &C, const Message &Msg) {
+  C.LastSeen = Clock::now();
+  StringRef Command = Msg.getCommand();
+
+  if (Command == FarmCommand::Next) {
+    if (!Queue.empty()) {
+      size_t Job = Queue.front();
+      Queue.pop_front();
+      Statuses[Job] = JobStatus::Running;
+      C.Job = static_cast<long>(Job);
+      SmallString<256> Path(Inputs[Job]);
+      sys::fs::make_absolute(Path);
+      std::vector<std::string> Args = {FarmCommand::Job, std::to_string(Job)};
+      appendJobOptions(Args, Opts.Analysis, Opts.LazyLoad);
+      C.Stream->send(Args, Path);
+    } else if (isFinished()) {
+      C.Stream->send({FarmCommand::Bye});
+    } else {
+      C.Stream->send({FarmCommand::Wait});
+    }
+    return;
+  }
+
+  if (Command == FarmCommand::Result && Msg.Args.size() == 3) {
+    size_t Job = 0;
+    if (StringRef(Msg.Args[1]).getAsInteger(10, Job) || Job >= Inputs.size()) {
+      return;
+    }
+    if (Statuses[Job] != JobStatus::Done && Statuses[Job] != JobStatus::Failed) {
+      if (Msg.Args[2] == "ok") {
+        Statuses[Job] = JobStatus::Done;
+        Reports[Job] = Msg.Payload;
+      } else {
+        errs() << "error: " << Msg.Payload << "\n";
+        Statuses[Job] = JobStatus::Failed;
+      }
+    }
+    if (C.Job == static_cast<long>(Job)) {
+      C.Job = -1;
+    }
+  }
+  // HEARTBEAT only refreshes LastSeen.
+}
+
+void Coordinator::writeMergedReport() {
+  std::string Error;
+  std::unique_ptr<SarifWriter> Writer;
+  if (!Opts.MergedOutput.empty()) {
+    Writer = SarifWriter::create(Opts.MergedOutput, Opts.Compact, Error);
+    if (!Writer) {
+      errs() << "error: " << Error << "\n";
+    }
+  }
+  std::unique_ptr<FindingsLogWriter> LogWriter;
+  if (!Opts.FindingsLog.empty()) {
+    LogWriter = FindingsLogWriter::create(Opts.FindingsLog, Error);
+    if (!LogWriter) {
+      errs() << "error: " << Error << "\n";
+    }
+  }
+  if (!Writer && !LogWriter) {
+    return;
+  }
+
+  for (size_t I = 0; I < Inputs.size(); ++I) {
+    if (Statuses[I] != JobStatus::Done) {
+      continue;
+    }
+    std::vector<BugReport> Found;
+    if ((Writer && !Writer->addResults(Reports[I])) || (LogWriter && !readResults(Reports[I], Found))) {
+      errs() << "error: malformed report for " << Inputs[I] << "\n";
+      continue;
+    }
+    for (const BugReport &Report : Found) {
+      LogWriter->add(Inputs[I], Report);
+    }
+  }
+  if (LogWriter) {
+    LogWriter->flush();
+  }
+}
+
+int Coordinator::run() {
+  std::string Error;
+  int ListenFd = listenOn(Opts.Address, Error);
+  if (ListenFd < 0) {
+    errs() << "error: cannot listen on " << Opts.Address << ": " << Error << "\n";
+    return -1;
+  }
+
+  Statuses.assign(Inputs.size(), JobStatus::Queued);
+  Attempts.assign(Inputs.size(), 0);
+  Reports.assign(Inputs.size(), {});
+  for (size_t I = 0; I < Inputs.size(); ++I) {
+    Queue.push_back(I);
+  }
+
+  while (!isFinished()) {
+    std::vector<pollfd> Fds = {{ListenFd, POLLIN, 0}};
+    for (Connection &C : Connections) {
+      Fds.push_back({C.Stream->getFd(), POLLIN, 0});
+    }
+
+    if (::poll(Fds.data(), Fds.size(), 500) > 0) {
+      for (size_t I = 1; I < Fds.size(); ++I) {
+        if (!(Fds[I].revents & (POLLIN | POLLHUP | POLLERR))) {
+          continue;
+        }
+        Connection &C = Connections[I - 1];
+        std::vector<Message> Received;
+        bool Open = C.Stream->poll(Received);
+        for (const Message &Msg : Received) {
+          handle(C, Msg);
+        }
+        if (!Open) {
+          dropConnection(C, "disconnected");
+        }
+      }
+      if (Fds[0].revents & POLLIN) {
+        int Fd = accept(ListenFd, nullptr, nullptr);
+        if (Fd >= 0) {
+          Connections.push_back({std::make_unique<MessageStream>(Fd), -1, Clock::now()});
+        }
+      }
+    }
+
+    auto Deadline = Clock::now() - std::chrono::seconds(Opts.HeartbeatTimeoutSec);
+    for (Connection &C : Connections) {
+      if (C.Stream->getFd() >= 0 && C.Job >= 0 && C.LastSeen < Deadline) {
+        dropConnection(C, "no heartbeat");
+      }
+    }
+    Connections.erase(std::remove_if(Connections.begin(), Connections.end(),
+                                     [](const Connection &C) { return C.Stream->getFd() < 0; }),
+                      Connections.end());
+  }
+
+  for (Connection &C : Connections) {
+    C.Stream->send({FarmCommand::Bye});
+  }
+  Connections.clear();
+  close(ListenFd);
+
+  writeMergedReport();
+
+  int Failed = 0;
+  for (JobStatus S : Statuses) {
+    Failed += S != JobStatus::Done;
+  }
+  return Failed;
+}
+
+int FarmWorker::run() {
+  std::string Error;
+  int Fd = connectTo(Opts.Address, Error);
+  if (Fd < 0) {
+    errs() << "error: cannot connect to " << Opts.Address << ": " << Error << "\n";
+    return -1;
+  }
+  MessageStream Stream(Fd);
+
+  int Analyzed = 0;
+  Message Msg;
+  while (Stream.send({FarmCommand::Next}) && Stream.receive(Msg)) {
+    if (Msg.getCommand() == FarmCommand::Wait) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      continue;
+    }
+    if (Msg.getCommand() != FarmCommand::Job || Msg.Args.size() < 2) {
+      break;
+    }
+    AnalyzerOptions Analysis;
+    bool Lazy = false;
+    if (!parseJobOptions(makeArrayRef(Msg.Args).drop_front(2), Analysis, Lazy)) {
+      Stream.send({FarmCommand::Result, Msg.Args[1], "error"}, "malformed options for " + Msg.Payload);
+      continue;
+    }
+
+    std::mutex Mutex;
+    std::condition_variable Finished;
+    bool Done = false;
+    std::thread Heartbeat([&] {
+      std::unique_lock<std::mutex> Lock(Mutex);
+      while (!Finished.wait_for(Lock, std::chrono::seconds(Opts.HeartbeatIntervalSec),
+                                [&] { return Done; })) {
+        Stream.send({FarmCommand::Heartbeat});
+      }
+    });
+
+    InputResult Result = analyzeFile(Msg.Payload, Lazy, nullptr, Analysis);
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Done = true;
+    }
+    Finished.notify_one();
+    Heartbeat.join();
+
+    if (Result.failed()) {
+      Stream.send({FarmCommand::Result, Msg.Args[1], "error"}, Result.Error);
+    } else {
+      // Only the coordinator reads this report, so it is sent compact.
+      std::string Report;
+      raw_string_ostream OS(Report);
+      {
+        SarifWriter Writer(OS, true);
+        for (const BugReport &Found : Result.Reports) {
+          Writer.addResult(Found);
+        }
+      }
+      Stream.send({FarmCommand::Result, Msg.Args[1], "ok"}, OS.str());
+    }
+    ++Analyzed;
+  }
+  return Analyzed;
+}
@@ -0,0 +1,208 @@
+#include "FindingsLog.h"
+#include "llvm/Support/Endian.h"
+#include <tuple>
+
+namespace {
+
+const char Magic[] = {'A', 'N', 'F', 'L'};
+const uint32_t Version = 1;
+
+enum RecordKind : uint8_t { HeaderRecord = 0, StringRecord = 1, FindingRecord = 2 };
+
+} // namespace
+
+BugReport LoggedFinding::toBugReport() const {
+  SmallVector<std::pair<std::string, unsigned>> Steps;
+  for (const auto &Step : Trace) {
+    Steps.emplace_back(Step.first.str(), Step.second);
+  }
+  return BugReport(Steps, RuleId, RuleIndex);
+}
+
+bool operator<(const LoggedFinding &LHS, const LoggedFinding &RHS) {
+  return std::tie(LHS.Input, LHS.RuleIndex, LHS.RuleId, LHS.Trace) <
+         std::tie(RHS.Input, RHS.RuleIndex, RHS.RuleId, RHS.Trace);
+}
+
+bool operator==(const LoggedFinding &LHS, const LoggedFinding &RHS) {
+  return std::tie(LHS.Input, LHS.RuleIndex, LHS.RuleId, LHS.Trace) ==
+         std::tie(RHS.Input, RHS.RuleIndex, RHS.RuleId, RHS.Trace);
+}
+
+FindingsLogWriter::FindingsLogWriter(std::unique_ptr<raw_fd_ostream> OS) : OS(std::move(OS)) {
+  *this->OS << char(HeaderRecord);
+  this->OS->write(Magic, sizeof(Magic));
+  writeU32(Version);
+}
+
+std::unique_ptr<FindingsLogWriter> FindingsLogWriter::create(const std::string &Path,
+                                                             std::string &Error) {
+  std::error_code EC;
+  auto OS = std::make_unique<raw_fd_ostream>(Path, EC);
+  if (EC) {
+    Error = "cannot write " + Path + ": " + EC.message();
+    return nullptr;
+  }
+  return std::unique_ptr<FindingsLogWriter>(new FindingsLogWriter(std::move(OS)));
+}
+
+void FindingsLogWriter::writeU32(uint32_t Value) {
+  char Bytes[4];
+  support::endian::write32le(Bytes, Value);
+  OS->write(Bytes, sizeof(Bytes));
+}
+
+/// Id of Str in this segment, defining it on first use.
+uint32_t FindingsLogWriter::intern(StringRef Str) {
+  auto Inserted = Strings.try_emplace(Str, Strings.size());
+  if (Inserted.second) {
+    *OS << char(StringRecord);
+    writeU32(Inserted.first->second);
+    writeU32(Str.size());
+    *OS << Str;
+  }
+  return Inserted.first->second;
+}
+
+void FindingsLogWriter::add(StringRef Input, const BugReport &Report) {
+  LoggedFinding Finding;
+  Finding.Input = Input;
+  Finding.RuleId = Report.RuleId;
+  Finding.RuleIndex = Report.RuleIndex;
+  for (const auto &Step : Report.Trace) {
+    Finding.Trace.emplace_back(Step.first, Step.second);
+  }
+  add(Finding);
+}
+
+void FindingsLogWriter::add(const LoggedFinding &Finding) {
+  // Define the strings first; a finding record is never interrupted.
+  uint32_t Input = intern(Finding.Input);
+  uint32_t Rule = intern(Finding.RuleId);
+  SmallVector<uint32_t, 2> Files;
+  for (const auto &Step : Finding.Trace) {
+    Files.push_back(intern(Step.first));
+  }
+
+  *OS << char(FindingRecord);
+  writeU32(Input);
+  writeU32(Rule);
+  writeU32(Finding.RuleIndex);
+  writeU32(Finding.Trace.size());
+  for (size_t I = 0; I < Files.size(); ++I) {
+    writeU32(Files[I]);
+    writeU32(Finding.Trace[I].second);
+  }
+}
+
+void FindingsLogWriter::flush() { OS->flush(); }
+
+FindingsLogReader::FindingsLogReader(std::unique_ptr<MemoryBuffer> Buffer, std::string Path)
+    : Buffer(std::move(Buffer)), Path(std::move(Path)) {}
+
+std::unique_ptr<FindingsLogReader> FindingsLogReader::open(const std::string &Path,
+                                                           std::string &Error) {
+  // MemoryBuffer maps large files, so only the pages being decoded need to
+  // be resident.
+  auto Buffer = MemoryBuffer::getFileOrSTDIN(Path);
+  if (!Buffer) {
+    Error = "cannot read " + Path + ": " + Buffer.getError().message();
+    return nullptr;
+  }
+  std::unique_ptr<FindingsLogReader> Reader(new FindingsLogReader(std::move(*Buffer), Path));
+  StringRef Data = Reader->Buffer->getBuffer();
+  if (!Data.empty() &&
+      (Data[0] != HeaderRecord || !Data.drop_front().startswith(StringRef(Magic, sizeof(Magic))))) {
+    Error = Path + " is not a findings log";
+    return nullptr;
+  }
+  return Reader;
+}
+
+bool FindingsLogReader::fail(const Twine &Message) {
+  Error = (Path + ": " + Message + " at offset " + Twine(Offset)).str();
+  return false;
+}
+
+bool FindingsLogReader::readU32(uint32_t &Value) {
+  StringRef Data = Buffer->getBuffer();
+  if (Data.size() - Offset < 4) {
+    return fail("truncated record");
+  }
+  Value = support::endian::read32le(Data.data() + Offset);
+  Offset += 4;
+  return true;
+}
+
+bool FindingsLogReader::readString(StringRef &Str) {
+  uint32_t Id;
+  if (!readU32(Id)) {
+    return false;
+  }
+  if (Id >= Strings.size()) {
+    return fail("undefined string " + Twine(Id));
+  }
+  Str = Strings[Id];
+  return true;
+}
+
+bool FindingsLogReader::next(LoggedFinding &Finding) {
+  StringRef Data = Buffer->getBuffer();
+  while (Offset < Data.size()) {
+    uint8_t Kind = Data[Offset++];
+    switch (Kind) {
+    case HeaderRecord: {
+      uint32_t LogVersion;
+      if (Data.size() - Offset < sizeof(Magic) ||
+          Data.substr(Offset, sizeof(Magic)) != StringRef(Magic, sizeof(Magic))) {
+        return fail("bad segment header");
+      }
+      Offset += sizeof(Magic);
+      if (!readU32(LogVersion)) {
+        return false;
+      }
+      if (LogVersion != Version) {
+        return fail("unsupported version " + Twine(LogVersion));
+      }
+      Strings.clear();
+      break;
+    }
+    case StringRecord: {
+      uint32_t Id, Length;
+      if (!readU32(Id) || !readU32(Length)) {
+        return false;
+      }
+      if (Id != Strings.size()) {
+        return fail("string " + Twine(Id) + " out of order");
+      }
+      if (Data.size() - Offset < Length) {
+        return fail("truncated string");
+      }
+      Strings.push_back(Data.substr(Offset, Length));
+      Offset += Length;
+      break;
+    }
+    case FindingRecord: {
+      uint32_t Steps;
+      Finding.Trace.clear();
+      if (!readString(Finding.Input) || !readString(Finding.RuleId) ||
+          !readU32(Finding.RuleIndex) || !readU32(Steps)) {
+        return false;
+      }
+      for (uint32_t I = 0; I < Steps; ++I) {
+        StringRef File;
+        uint32_t Line;
+        if (!readString(File) || !readU32(Line)) {
+          return false;
+        }
+        Finding.Trace.emplace_back(File, Line);
+      }
+      return true;
+    }
+    default:
+      --Offset;
+      return fail("unknown record kind " + Twine(unsigned(Kind)));
+    }
+  }
+  return false;
+}
@@ -0,0 +1,163 @@
+#include "FindingsLog.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+enum class OutputFormat { Sarif, Log };
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::desc("<findings logs>"), cl::OneOrMore);
+
+static cl::opt<std::string> OutputPath("o", cl::desc("Output path ('-' for stdout)"),
+                                       cl::value_desc("file"), cl::init("-"));
+
+static cl::opt<OutputFormat> Format(
+    "format", cl::desc("Output format"),
+    cl::values(clEnumValN(OutputFormat::Sarif, "sarif", "SARIF 2.1.0 report (default)"),
+               clEnumValN(OutputFormat::Log, "log", "Merged findings log")),
+    cl::init(OutputFormat::Sarif));
+
+static cl::opt<bool> Compact("compact", cl::desc("Write SARIF without indentation"),
+                             cl::init(false));
+
+static cl::opt<unsigned> RunSize("run-size",
+                                 cl::desc("Findings sorted in memory before spilling to a "
+                                          "temporary log"),
+                                 cl::init(1 << 20));
+
+using FindingSink = std::function<void(const LoggedFinding &)>;
+
+/// Sort Run and pass it on without duplicates.
+static void emitRun(std::vector<LoggedFinding> &Run, const FindingSink &Sink) {
+  std::sort(Run.begin(), Run.end());
+  Run.erase(std::unique(Run.begin(), Run.end()), Run.end());
+  for (const LoggedFinding &Finding : Run) {
+    Sink(Finding);
+  }
+  Run.clear();
+}
+
+/// Merge sorted logs, dropping findings reported by more than one of them.
+static bool mergeRuns(const std::vector<std::string> &Paths, const FindingSink &Sink) {
+  struct Head {
+    LoggedFinding Finding;
+    size_t Reader;
+  };
+  auto Later = [](const Head &LHS, const Head &RHS) { return RHS.Finding < LHS.Finding; };
+  std::priority_queue<Head, std::vector<Head>, decltype(Later)> Heads(Later);
+
+  std::vector<std::unique_ptr<FindingsLogReader>> Readers;
+  for (const std::string &Path : Paths) {
+    std::string Error;
+    auto Reader = FindingsLogReader::open(Path, Error);
+    if (!Reader) {
+      errs() << "error: " << Error << "\n";
+      return false;
+    }
+    Head First{{}, Readers.size()};
+    if (Reader->next(First.Finding)) {
+      Heads.push(First);
+    }
+    Readers.push_back(std::move(Reader));
+  }
+
+  // The strings of the readers outlive Last.
+  Optional<LoggedFinding> Last;
+  while (!Heads.empty()) {
+    Head Top = Heads.top();
+    Heads.pop();
+    if (!Last || !(*Last == Top.Finding)) {
+      Sink(Top.Finding);
+      Last = Top.Finding;
+    }
+    Head Next{{}, Top.Reader};
+    if (Readers[Top.Reader]->next(Next.Finding)) {
+      Heads.push(Next);
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "merge findings logs and convert them to SARIF\n");
+
+  std::string Error;
+  std::unique_ptr<SarifWriter> Sarif;
+  std::unique_ptr<FindingsLogWriter> Log;
+  if (Format == OutputFormat::Sarif) {
+    Sarif = SarifWriter::create(OutputPath, Compact, Error);
+  } else {
+    Log = FindingsLogWriter::create(OutputPath, Error);
+  }
+  if (!Sarif && !Log) {
+    errs() << "error: " << Error << "\n";
+    return 1;
+  }
+  FindingSink Sink = [&](const LoggedFinding &Finding) {
+    if (Sarif) {
+      Sarif->addResult(Finding.toBugReport());
+    } else {
+      Log->add(Finding);
+    }
+  };
+
+  // External merge sort: the findings are sorted in runs of RunSize, which
+  // are spilled to temporary logs when there is more than one and merged at
+  // the end. The inputs stay mapped until then, since the findings of a run
+  // point into them.
+  std::vector<std::unique_ptr<FindingsLogReader>> Inputs;
+  std::vector<LoggedFinding> Run;
+  std::vector<std::string> Spilled;
+  std::vector<std::unique_ptr<FileRemover>> Removers;
+  auto Spill = [&]() -> bool {
+    SmallString<128> Path;
+    if (std::error_code EC = sys::fs::createTemporaryFile("analyzer-findings", "log", Path)) {
+      errs() << "error: cannot create a temporary file: " << EC.message() << "\n";
+      return false;
+    }
+    Removers.push_back(std::make_unique<FileRemover>(Path));
+    auto Writer = FindingsLogWriter::create(Path.str().str(), Error);
+    if (!Writer) {
+      errs() << "error: " << Error << "\n";
+      return false;
+    }
+    emitRun(Run, [&Writer](const LoggedFinding &Finding) { Writer->add(Finding); });
+    Spilled.push_back(Path.str().str());
+    return true;
+  };
+
+  bool Failed = false;
+  for (const std::string &Path : InputFiles) {
+    auto Reader = FindingsLogReader::open(Path, Error);
+    if (!Reader) {
+      errs() << "error: " << Error << "\n";
+      Failed = true;
+      continue;
+    }
+    LoggedFinding Finding;
+    while (Reader->next(Finding)) {
+      Run.push_back(Finding);
+      if (Run.size() >= std::max(1u, unsigned(RunSize)) && !Spill()) {
+        return 1;
+      }
+    }
+    // A log cut short by a crashed writer still contributes what it holds.
+    if (!Reader->getError().empty()) {
+      errs() << "warning: " << Reader->getError() << "\n";
+      Failed = true;
+    }
+    Inputs.push_back(std::move(Reader));
+  }
+
+  if (Spilled.empty()) {
+    emitRun(Run, Sink);
+  } else if ((!Run.empty() && !Spill()) || !mergeRuns(Spilled, Sink)) {
+    return 1;
+  }
+  return Failed ? 1 : 0;
+}
@@ -1,4 +1,8 @@
 #include "FuncInfo.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/IR/InstIterator.h"
+
+#include <functional>
 
 namespace llvm {
 
@@ -25,6 +29,13 @@ bool IsCallWithName(Instruction *inst, const std::string &name) {
   return false;
 }
 
+bool IsRelevantCall(StringRef name) {
+  static const StringSet<> relevantCalls = {CallInstruction::Malloc, CallInstruction::Free,
+                                            CallInstruction::Memcpy, CallInstruction::Strcpy,
+                                            CallInstruction::Snprintf, CallInstruction::Scanf};
+  return relevantCalls.count(name);
+}
+
 MallocedObject::MallocedObject(Instruction *inst) {
   base = inst;
 }
@@ -52,6 +63,10 @@ void MallocedObject::addFreeCall(Instruction *free) {
   mallocFree.second.push_back(free);
 }
 
+void MallocedObject::clearFreeCalls() {
+  mallocFree.second.clear();
+}
+
 MallocedObject *MallocedObject::getMainObj() const {
   return main;
 }
@@ -119,7 +134,188 @@ void FuncInfo::CollectCalls(Instruction *callInst) {
   }
 }
 
-std::unordered_map<Value *, std::unordered_set<Value *>> *FuncInfo::SelectMap(AnalyzerMap mapID) {
+void FuncInfo::NumberValues() {
+  size_t ordinal = 0;
+  for (Argument &arg : function->args()) {
+    ordinals[&arg] = ordinal++;
+  }
+  for (BasicBlock &bb : *function) {
+    for (Instruction &inst : bb) {
+      ordinals[&inst] = ordinal++;
+    }
+  }
+}
+
+size_t FuncInfo::GetOrdinal(Value *val) const {
+  auto it = ordinals.find(val);
+  if (it == ordinals.end()) {
+    return SIZE_MAX;
+  }
+  return it->second;
+}
+
+GraphBudget::GraphBudget(size_t limit) : limit(limit) {}
+
+void GraphBudget::Touch(FuncInfo *info) {
+  auto it = positions.find(info);
+  if (it != positions.end()) {
+    lru.splice(lru.begin(), lru, it->second);
+    return;
+  }
+  lru.push_front(info);
+  positions[info] = lru.begin();
+  resident += info->GetGraphCost();
+
+  // Release from the cold end. The FuncInfo just requested stays resident.
+  auto candidate = std::prev(lru.end());
+  while (resident > limit && candidate != lru.begin()) {
+    FuncInfo *victim = *candidate;
+    --candidate;
+    if (!victim->IsPinned()) {
+      victim->Release();
+    }
+  }
+}
+
+void GraphBudget::Forget(FuncInfo *info) {
+  auto it = positions.find(info);
+  if (it == positions.end()) {
+    return;
+  }
+  resident -= info->GetGraphCost();
+  lru.erase(it->second);
+  positions.erase(it);
+}
+
+size_t GraphBudget::GetResident() const {
+  return resident;
+}
+
+// Mirrors ProcessStoreInsts: such a store links its value to its pointer and
+// gets no dependency edges itself.
+static bool LinksValueToPointer(StoreInst *store) {
+  Value *value = store->getValueOperand();
+  if (isa<Constant>(value)) {
+    return false;
+  }
+  return isa<Argument>(value) || (isa<Instruction>(value) && isa<Instruction>(store->getPointerOperand()));
+}
+
+// Values the checkers start from or look for: arguments and returns, which
+// connect functions, the calls (library calls are the allocations, frees and
+// buffer operations), comparisons, and arrays.
+static bool IsSliceSeed(Instruction &inst) {
+  if (inst.isDebugOrPseudoInst()) {
+    return false;
+  }
+  if (isa<CallBase>(inst) || isa<ReturnInst>(inst) || isa<ICmpInst>(inst)) {
+    return true;
+  }
+  if (auto *alloca = dyn_cast<AllocaInst>(&inst)) {
+    return alloca->getAllocatedType()->isArrayTy();
+  }
+  if (auto *gep = dyn_cast<GetElementPtrInst>(&inst)) {
+    return gep->getSourceElementType()->isArrayTy();
+  }
+  return false;
+}
+
+// Union of the forward and the backward slice of the seeds over the same
+// def-use and store edges ConstructDataDeps adds.
+void FuncInfo::ComputeSlice() {
+  slice.clear();
+  if (!slicing) {
+    return;
+  }
+  std::vector<Value *> seeds;
+  for (Argument &arg : function->args()) {
+    seeds.push_back(&arg);
+  }
+  for (Instruction &inst : instructions(function)) {
+    if (IsSliceSeed(inst)) {
+      seeds.push_back(&inst);
+    }
+  }
+
+  auto forEachSuccessor = [](Value *val, const std::function<void(Value *)> &visit) {
+    for (User *user : val->users()) {
+      auto *userInst = dyn_cast<Instruction>(user);
+      if (!userInst) {
+        continue;
+      }
+      auto *store = dyn_cast<StoreInst>(userInst);
+      if (store && LinksValueToPointer(store)) {
+        if (store->getValueOperand() == val) {
+          visit(store->getPointerOperand());
+        }
+        continue;
+      }
+      visit(userInst);
+    }
+  };
+  auto forEachPredecessor = [](Value *val, const std::function<void(Value *)> &visit) {
+    if (auto *inst = dyn_cast<Instruction>(val)) {
+      auto *store = dyn_cast<StoreInst>(inst);
+      if (!store || !LinksValueToPointer(store)) {
+        for (Value *op : inst->operands()) {
+          if (isa<Instruction>(op)) {
+            visit(op);
+          }
+        }
+      }
+    }
+    for (User *user : val->users()) {
+      auto *store = dyn_cast<StoreInst>(user);
+      if (store && LinksValueToPointer(store) && store->getPointerOperand() == val) {
+        visit(store->getValueOperand());
+      }
+    }
+  };
+
+  auto closure = [&seeds, this](const std::function<void(Value *, const std::function<void(Value *)> &)> &next) {
+    std::unordered_set<Value *> reached(seeds.begin(), seeds.end());
+    std::vector<Value *> worklist(seeds.begin(), seeds.end());
+    while (!worklist.empty()) {
+      Value *current = worklist.back();
+      worklist.pop_back();
+      next(current, [&reached, &worklist](Value *val) {
+        if (reached.insert(val).second) {
+          worklist.push_back(val);
+        }
+      });
+    }
+    slice.insert(reached.begin(), reached.end());
+  };
+  closure(forEachSuccessor);
+  closure(forEachPredecessor);
+}
+
+bool FuncInfo::InSlice(Value *val) const {
+  return !slicing || slice.count(val);
+}
+
+// The flow graph also keeps every terminator, call and comparison, and the
+// first instruction of each block, so that branches and the traversal into
+// callees still have their targets.
+bool FuncInfo::InFlowSlice(Instruction *inst) const {
+  if (InSlice(inst) || inst->isTerminator() || isa<CallBase>(inst) || isa<ICmpInst>(inst)) {
+    return true;
+  }
+  BasicBlock *bb = inst->getParent();
+  return inst == &bb->front() || inst == bb->getFirstNonPHIOrDbg();
+}
+
+ValueGraph *FuncInfo::SelectMap(AnalyzerMap mapID) {
+  if (!graphsBuilt) {
+    BuildGraphs();
+  }
+  if (budget) {
+    budget->Touch(this);
+  }
+  return GetMap(mapID);
+}
+
+ValueGraph *FuncInfo::GetMap(AnalyzerMap mapID) {
   switch (mapID) {
   case AnalyzerMap::ForwardDependencyMap:return &forwardDependencyMap;
   case AnalyzerMap::BackwardDependencyMap:return &backwardDependencyMap;
@@ -130,23 +326,27 @@ std::unordered_map<Value *, std::unordered_set<Value *>> *FuncInfo::SelectMap(An
 }
 
 void FuncInfo::AddEdge(AnalyzerMap mapID, Value *source, Value *destination) {
-  auto *map = SelectMap(mapID);
+  if ((mapID == AnalyzerMap::ForwardDependencyMap || mapID == AnalyzerMap::BackwardDependencyMap) &&
+      (!InSlice(source) || !InSlice(destination))) {
+    return;
+  }
+  auto *map = GetMap(mapID);
   map->operator[](source).insert(destination);
 }
 
 bool FuncInfo::HasEdge(AnalyzerMap mapID, Value *source, Value *destination) {
-  auto *map = SelectMap(mapID);
+  auto *map = GetMap(mapID);
   auto sourceIt = map->find(source);
   if (sourceIt != map->end()) {
-    return sourceIt->second.find(destination) != sourceIt->second.end();
+    return sourceIt->second.count(destination);
   }
   return false;
 }
 
 void FuncInfo::RemoveEdge(AnalyzerMap mapID, Value *source, Value *destination) {
-  auto *map = SelectMap(mapID);
+  auto *map = GetMap(mapID);
   if (HasEdge(mapID, source, destination)) {
-    map->operator[](source).erase(destination);
+    map->operator[](source).remove(destination);
   }
 }
 
@@ -180,8 +380,6 @@ bool FuncInfo::ProcessStoreInsts(Instruction *storeInst) {
 bool FuncInfo::ProcessGepInsts(Instruction *gInst) {
   auto *gepInst = dyn_cast<GetElementPtrInst>(gInst);
   auto *firstOp = dyn_cast<Instruction>(gepInst->getOperand(0));
-  errs() << *gepInst << " - gep\n";
-  errs() << *firstOp << "\n";
   // TODO: check this later
   if (backwardDependencyMap.find(firstOp) == backwardDependencyMap.end()) {
     return false;
@@ -209,7 +407,6 @@ void FuncInfo::UpdateDataDeps() {
   }
 
   for (Instruction *mallocInst : callInstructions.at(CallInstruction::Malloc)) {
-    errs() << "process " << *mallocInst << "\n";
     for (auto &dependentVal : forwardDependencyMap[mallocInst]) {
       auto *dependentInst = dyn_cast<Instruction>(dependentVal);
       if (dependentInst->getOpcode() == Instruction::GetElementPtr) {
@@ -220,17 +417,14 @@ void FuncInfo::UpdateDataDeps() {
 }
 
 void FuncInfo::CollectMallocedObjs() {
-  errs() << "}}}}}}}\n";
   if (callInstructions.empty() ||
       callInstructions.find(CallInstruction::Malloc) == callInstructions.end()) {
     return;
   }
-  errs() << "}}}}}}}\n";
 
   for (Instruction *mallocInst : callInstructions[CallInstruction::Malloc]) {
     DFS(AnalyzerMap::ForwardDependencyMap, mallocInst, [mallocInst, this](Value *current) {
       auto *currentInst = dyn_cast<Instruction>(current);
-      errs() << "curr: " << *currentInst << "\n";
       if (currentInst->getOpcode() == Instruction::Alloca) {
         auto obj = std::make_shared<MallocedObject>(currentInst);
         obj->setMallocCall(mallocInst);
@@ -238,35 +432,15 @@ void FuncInfo::CollectMallocedObjs() {
         return true;
       }
       if (currentInst->getOpcode() == Instruction::GetElementPtr) {
-        errs() << "MMM\n";
         auto obj = std::make_shared<MallocedObject>(currentInst);
-        errs() << "MMM\n";
-
         obj->setMallocCall(mallocInst);
-        errs() << "MMM\n";
-
         auto *gep = dyn_cast<GetElementPtrInst>(currentInst);
-        errs() << "MMM\n";
-
         size_t offset = CalculateOffsetInBits(gep);
-        errs() << "MMM\n";
-
-        printMap(AnalyzerMap::ForwardDependencyMap);
-
-        if (forwardDependencyMap.find(current) == forwardDependencyMap.end()) {
-          errs() << "lav ches\n";
-        }
-
         // nextInst = parentInst. Alloca is the next to gep, see updateDependencies()
         auto *next = dyn_cast<Instruction>(*(forwardDependencyMap[current].begin()));
-        errs() << "MMM\n";
-
         obj->setOffset(FindSuitableObj(next), offset);
 
-        errs() << "MMM\n";
         mallocedObjs[mallocInst] = obj;
-        errs() << "MMM\n";
-
         return true;
       }
       return false;
@@ -276,6 +450,21 @@ void FuncInfo::CollectMallocedObjs() {
 }
 
 void FuncInfo::CreateEdgesInBB(BasicBlock *bb) {
+  // Instructions left out of the slice are bridged by an edge between the
+  // kept ones around them.
+  if (slicing) {
+    Instruction *previous = nullptr;
+    for (auto &inst : *bb) {
+      if (inst.isDebugOrPseudoInst() || !InFlowSlice(&inst)) {
+        continue;
+      }
+      if (previous) {
+        AddEdge(AnalyzerMap::ForwardFlowMap, previous, &inst);
+      }
+      previous = &inst;
+    }
+    return;
+  }
   for (auto &inst : *bb) {
     if (inst.isDebugOrPseudoInst()) {
       continue;
@@ -309,6 +498,9 @@ void FuncInfo::ConstructDataDeps() {
       if (inst.getOpcode() == Instruction::Call) {
         CollectCalls(&inst);
       }
+      if (!InSlice(&inst)) {
+        continue;
+      }
 
       auto uses = inst.uses();
       if (uses.empty()) {
@@ -330,25 +522,73 @@ void FuncInfo::ConstructDataDeps() {
   UpdateDataDeps();
 }
 
-FuncInfo::FuncInfo(llvm::Function *func) {
+FuncInfo::FuncInfo(llvm::Function *func, GraphBudget *graphBudget, bool sliceGraphs) {
   function = func;
+  budget = graphBudget;
+  slicing = sliceGraphs;
   const BasicBlock &lastBB = *(--(func->end()));
   if (!lastBB.empty()) {
     ret = const_cast<Instruction *>(&*(--(lastBB.end())));
   }
-  errs() << "EEEEE\n";
+  NumberValues();
+  ComputeSlice();
   ConstructDataDeps();
-  errs() << "EEEEE\n";
-
   CollectMallocedObjs();
-  errs() << "EEEEE\n";
+  ConstructFlowDeps();
+  std::unordered_set<Value *>().swap(slice);
+  DetectLoops();
+  graphsBuilt = true;
+  if (budget) {
+    budget->Touch(this);
+  }
+}
+
+FuncInfo::~FuncInfo() {
+  if (budget) {
+    budget->Forget(this);
+  }
+}
 
+// Rebuild the graphs of a released FuncInfo. The summary collected by the
+// constructor is kept as is.
+void FuncInfo::BuildGraphs() {
+  callInstructions.clear();
+  ComputeSlice();
+  ConstructDataDeps();
   ConstructFlowDeps();
-  errs() << "EEEEE\n";
+  std::unordered_set<Value *>().swap(slice);
+  graphsBuilt = true;
+}
 
-  DetectLoops();
-  errs() << "EEEEE\n";
+void FuncInfo::Release() {
+  if (budget) {
+    budget->Forget(this);
+  }
+  ValueGraph().swap(forwardDependencyMap);
+  ValueGraph().swap(backwardDependencyMap);
+  ValueGraph().swap(forwardFlowMap);
+  ValueGraph().swap(backwardFlowMap);
+  graphsBuilt = false;
+}
+
+bool FuncInfo::HasGraphs() const {
+  return graphsBuilt;
+}
+
+size_t FuncInfo::GetGraphCost() const {
+  return ordinals.size();
+}
 
+void FuncInfo::Pin() {
+  ++pins;
+}
+
+void FuncInfo::Unpin() {
+  --pins;
+}
+
+bool FuncInfo::IsPinned() const {
+  return pins != 0;
 }
 
 MallocedObject *FuncInfo::FindSuitableObj(Instruction *base) {
@@ -365,7 +605,7 @@ bool FuncInfo::DFS(AnalyzerMap mapID,
                    Instruction *start,
                    const std::function<bool(Value *)> &terminationCondition,
                    const std::function<bool(Value *)> &continueCondition) {
-  auto *map = SelectMap(mapID);
+  auto *map = GetMap(mapID);
 
   std::unordered_set<Value *> visitedInstructions;
   std::stack<Value *> dfsStack;
@@ -415,13 +655,18 @@ Instruction *FuncInfo::GetDeclaration(Instruction *inst) {
 }
 
 void FuncInfo::printMap(AnalyzerMap mapID) {
-  auto *map = SelectMap(mapID);
+  auto *map = GetMap(mapID);
 
+  std::vector<Value *> sources;
   for (auto &pair : *map) {
-    Value *to = pair.first;
-    std::unordered_set<Value *> successors = pair.second;
+    sources.push_back(pair.first);
+  }
+  std::sort(sources.begin(), sources.end(), [this](Value *lhs, Value *rhs) {
+    return GetOrdinal(lhs) < GetOrdinal(rhs);
+  });
 
-    for (Value *successor : successors) {
+  for (Value *to : sources) {
+    for (Value *successor : map->at(to)) {
       errs() << *to << "-->" << *successor << "\n";
     }
   }
@@ -526,6 +771,17 @@ std::shared_ptr<LoopsInfo> FuncInfo::GetLoopInfo() {
   return loopInfo;
 }
 
+void FuncInfo::ResetCheckResults() {
+  for (auto &objPair : mallocedObjs) {
+    if (objPair.second) {
+      objPair.second->clearFreeCalls();
+    }
+  }
+  if (loopInfo) {
+    loopInfo->SetRange({});
+  }
+}
+
 void FuncInfo::SetLoopRange(std::pair<int64_t, int64_t> range) {
   // validate only ICMP_SLT and ICMP_SLE
   auto predicate = loopInfo->GetPredicate();
@@ -547,11 +803,13 @@ void FuncInfo::CreateBBCFG() {
 
 void FuncInfo::printBBCFG() {
 
-  for (auto &pair : bbCFG) {
-    BasicBlock *to = pair.first;
-    std::unordered_set<BasicBlock *> successors = pair.second;
+  for (BasicBlock &BB : *function) {
+    if (bbCFG.find(&BB) == bbCFG.end()) {
+      continue;
+    }
+    BasicBlock *to = &BB;
 
-    for (BasicBlock *successor : successors) {
+    for (BasicBlock *successor : bbCFG[&BB]) {
       errs() << *to << "-->" << *successor << "\n";
 //      outs() << Successor->getName() << " ";
     }
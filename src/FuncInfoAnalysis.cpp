@@ -0,0 +1,25 @@
+#include "FuncInfoAnalysis.h"
+
+namespace llvm {
+
+AnalysisKey FuncInfoAnalysis::Key;
+
+FuncInfoAnalysis::Result::Result(std::shared_ptr<FuncInfo> funcInfo) : info(std::move(funcInfo)) {}
+
+const std::shared_ptr<FuncInfo> &FuncInfoAnalysis::Result::GetFuncInfo() const {
+  return info;
+}
+
+bool FuncInfoAnalysis::Result::invalidate(Function &, const PreservedAnalyses &preserved,
+                                          FunctionAnalysisManager::Invalidator &) {
+  auto checker = preserved.getChecker<FuncInfoAnalysis>();
+  return !checker.preserved() && !checker.preservedSet<AllAnalysesOn<Function>>();
+}
+
+FuncInfoAnalysis::FuncInfoAnalysis(bool sliceGraphs) : slice(sliceGraphs) {}
+
+FuncInfoAnalysis::Result FuncInfoAnalysis::run(Function &function, FunctionAnalysisManager &) {
+  return Result(std::make_shared<FuncInfo>(&function, nullptr, slice));
+}
+
+} // namespace llvm
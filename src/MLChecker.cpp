@@ -253,6 +253,26 @@ std::pair<Value *, Instruction *> MLChecker::Check(Function *function) {
   return {};
 }
 
+void MLChecker::MatchFreeCalls(Function *function) {
+  for (Instruction *malloc : FindAllMallocCalls(function)) {
+    FuncInfo *funcInfo = funcInfos[malloc->getFunction()].get();
+    auto objIt = funcInfo->mallocedObjs.find(malloc);
+    if (objIt == funcInfo->mallocedObjs.end() || !objIt->second) {
+      continue;
+    }
+    MallocedObject *obj = objIt->second.get();
+    auto freeCalls = CollectAllInstsWithType(AnalyzerMap::ForwardFlowMap, malloc,
+                                             [](Instruction *inst) {
+                                               return IsCallWithName(inst, CallInstruction::Free);
+                                             });
+    for (Instruction *free : freeCalls) {
+      if (!(obj->isMallocedWithOffset() && HasMallocFreePathWithOffset(obj, free))) {
+        HasMallocFreePath(obj, free);
+      }
+    }
+  }
+}
+
 std::vector<Instruction *> MLChecker::FindAllMallocCalls(Function *function) {
   return CollectAllInstsWithType(AnalyzerMap::ForwardFlowMap, &*function->getEntryBlock().begin(),
                                  [](Instruction *inst) {
@@ -0,0 +1,129 @@
+#include "ModuleSummary.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace {
+
+const char *const Header = "ANSUMMARY 1";
+
+/// Summary file of the input at Path: one per absolute input path.
+std::string summaryFile(const std::string &Dir, const std::string &Path) {
+  SmallString<256> Absolute(Path);
+  sys::fs::make_absolute(Absolute);
+  MD5 Hasher;
+  Hasher.update(Absolute);
+  MD5::MD5Result Result;
+  Hasher.final(Result);
+  SmallString<256> File(Dir);
+  sys::path::append(File, Result.digest().str() + ".summary");
+  return File.str().str();
+}
+
+/// Identifies the contents of the input the summary was computed from.
+std::string inputStamp(const std::string &Path) {
+  sys::fs::file_status Status;
+  if (sys::fs::status(Path, Status)) {
+    return "";
+  }
+  return std::string(Header) + " " + std::to_string(Status.getSize()) + " " +
+         std::to_string(Status.getLastModificationTime().time_since_epoch().count());
+}
+
+} // namespace
+
+bool ModuleSummary::compute(Module &M, bool WithCalls, ModuleSummary &Summary,
+                            std::string &Error) {
+  for (Function &F : M) {
+    if (F.isDeclaration()) {
+      continue;
+    }
+    FunctionEntry Entry;
+    Entry.Name = F.getName().str();
+    Entry.Local = F.hasLocalLinkage();
+    if (WithCalls) {
+      if (llvm::Error E = F.materialize()) {
+        Error = "cannot materialize " + Entry.Name + ": " + toString(std::move(E));
+        return false;
+      }
+      for (Instruction &I : instructions(F)) {
+        auto *Call = dyn_cast<CallBase>(&I);
+        if (Call && Call->getCalledFunction()) {
+          Entry.Callees.push_back(Call->getCalledFunction()->getName().str());
+        }
+      }
+    }
+    Summary.Functions.push_back(std::move(Entry));
+  }
+  for (GlobalVariable &GV : M.globals()) {
+    if (!GV.isDeclaration() && !GV.hasLocalLinkage()) {
+      Summary.Variables.push_back(GV.getName().str());
+    }
+  }
+  return true;
+}
+
+bool ModuleSummary::read(const std::string &Dir, const std::string &Path) {
+  auto Buffer = MemoryBuffer::getFile(summaryFile(Dir, Path));
+  if (!Buffer) {
+    return false;
+  }
+  line_iterator Line(**Buffer, true), End;
+  if (Line == End || *Line != inputStamp(Path)) {
+    return false;
+  }
+  for (++Line; Line != End; ++Line) {
+    StringRef Kind = Line->take_front(2);
+    StringRef Name = Line->drop_front(2);
+    if (Kind == "F " || Kind == "L ") {
+      Functions.push_back({Name.str(), Kind == "L ", {}});
+    } else if (Kind == "C " && !Functions.empty()) {
+      Functions.back().Callees.push_back(Name.str());
+    } else if (Kind == "V ") {
+      Variables.push_back(Name.str());
+    } else {
+      Functions.clear();
+      Variables.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+void ModuleSummary::write(const std::string &Dir, const std::string &Path) const {
+  std::string Stamp = inputStamp(Path);
+  if (Stamp.empty() || sys::fs::create_directories(Dir)) {
+    return;
+  }
+  std::string File = summaryFile(Dir, Path);
+  std::string TempPath = File + ".tmp";
+  {
+    std::error_code EC;
+    raw_fd_ostream OS(TempPath, EC);
+    if (EC) {
+      errs() << "warning: cannot write summary " << TempPath << ": " << EC.message() << "\n";
+      return;
+    }
+    // One record per line: F/L for external/local functions followed by C
+    // for each of their callees, V for variables.
+    OS << Stamp << "\n";
+    for (const FunctionEntry &Entry : Functions) {
+      OS << (Entry.Local ? "L " : "F ") << Entry.Name << "\n";
+      for (const std::string &Callee : Entry.Callees) {
+        OS << "C " << Callee << "\n";
+      }
+    }
+    for (const std::string &Name : Variables) {
+      OS << "V " << Name << "\n";
+    }
+  }
+  if (std::error_code EC = sys::fs::rename(TempPath, File)) {
+    errs() << "warning: cannot write summary " << File << ": " << EC.message() << "\n";
+    sys::fs::remove(TempPath);
+  }
+}
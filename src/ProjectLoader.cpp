@@ -0,0 +1,257 @@
+#include "ProjectLoader.h"
+#include "BatchDriver.h"
+#include "FuncInfo.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include <algorithm>
+#include <map>
+
+namespace {
+
+void collectDiagnostic(const DiagnosticInfo &Info, void *Context) {
+  if (Info.getSeverity() != DS_Error) {
+    return;
+  }
+  raw_string_ostream OS(*static_cast<std::string *>(Context));
+  DiagnosticPrinterRawOStream Printer(OS);
+  Info.print(Printer);
+  OS << "\n";
+}
+
+/// Declare Name in Dest with the type it has in Src, so that linking Src with
+/// LinkOnlyNeeded imports its definition.
+void declareIn(Module &Dest, const Module &Src, StringRef Name) {
+  if (Dest.getNamedValue(Name)) {
+    return;
+  }
+  if (const Function *F = Src.getFunction(Name)) {
+    Dest.getOrInsertFunction(Name, F->getFunctionType());
+  } else if (const GlobalVariable *GV = Src.getNamedGlobal(Name)) {
+    Dest.getOrInsertGlobal(Name, GV->getValueType());
+  }
+}
+
+/// Key of a function in the project: local functions are qualified with the
+/// index of their input.
+std::string functionKey(size_t Index, StringRef Name, bool Local) {
+  return Local ? std::to_string(Index) + ":" + Name.str() : Name.str();
+}
+
+} // namespace
+
+bool ProjectLoader::collectInputs(const std::string &Path, std::vector<std::string> &Inputs,
+                                  std::string &Error) {
+  if (sys::fs::is_directory(Path)) {
+    std::vector<std::string> Found;
+    std::error_code EC;
+    for (sys::fs::recursive_directory_iterator It(Path, EC), End; It != End && !EC;
+         It.increment(EC)) {
+      StringRef Ext = sys::path::extension(It->path());
+      if (Ext == ".bc" || Ext == ".ll") {
+        Found.push_back(It->path());
+      }
+    }
+    if (EC) {
+      Error = "cannot scan " + Path + ": " + EC.message();
+      return false;
+    }
+    std::sort(Found.begin(), Found.end());
+    Inputs.insert(Inputs.end(), Found.begin(), Found.end());
+    return true;
+  }
+
+  auto Buffer = MemoryBuffer::getFile(Path);
+  if (!Buffer) {
+    Error = "cannot read " + Path + ": " + Buffer.getError().message();
+    return false;
+  }
+  for (line_iterator Line(**Buffer, true), End; Line != End; ++Line) {
+    Inputs.push_back(Line->trim().str());
+  }
+  return true;
+}
+
+bool ProjectLoader::buildIndex(const std::vector<std::string> &Inputs, LLVMContext &Context,
+                               std::string &Error) {
+  Definitions.clear();
+  Summaries.assign(Inputs.size(), {});
+  for (size_t I = 0; I < Inputs.size(); ++I) {
+    ModuleSummary &Summary = Summaries[I];
+    bool Stored = Opts.Prescreen && !Opts.SummaryDir.empty() &&
+                  Summary.read(Opts.SummaryDir, Inputs[I]);
+    if (!Stored) {
+      std::unique_ptr<Module> M = parseInput(Inputs[I], Context, Error, true);
+      if (!M || !ModuleSummary::compute(*M, Opts.Prescreen, Summary, Error)) {
+        return false;
+      }
+      if (Opts.Prescreen && !Opts.SummaryDir.empty()) {
+        Summary.write(Opts.SummaryDir, Inputs[I]);
+      }
+    }
+
+    // The first definition wins, like with a traditional linker and archives
+    // in command line order.
+    for (const ModuleSummary::FunctionEntry &Entry : Summary.Functions) {
+      if (!Entry.Local) {
+        Definitions.try_emplace(Entry.Name, I);
+      }
+    }
+    for (const std::string &Name : Summary.Variables) {
+      Definitions.try_emplace(Name, I);
+    }
+  }
+  if (Opts.Prescreen) {
+    computeRelevant();
+  }
+  return true;
+}
+
+void ProjectLoader::computeRelevant() {
+  // Invert the call graph of the whole project, then walk it from the callers
+  // of the library functions the checkers look at.
+  Relevant.clear();
+  StringMap<std::vector<std::string>> Callers;
+  std::vector<std::string> Worklist;
+  for (size_t I = 0; I < Summaries.size(); ++I) {
+    StringSet<> Locals;
+    for (const ModuleSummary::FunctionEntry &Entry : Summaries[I].Functions) {
+      if (Entry.Local) {
+        Locals.insert(Entry.Name);
+      }
+    }
+    for (const ModuleSummary::FunctionEntry &Entry : Summaries[I].Functions) {
+      std::string Key = functionKey(I, Entry.Name, Entry.Local);
+      for (const std::string &Callee : Entry.Callees) {
+        if (IsRelevantCall(Callee)) {
+          if (Relevant.insert(Key).second) {
+            Worklist.push_back(Key);
+          }
+        } else {
+          Callers[functionKey(I, Callee, Locals.count(Callee))].push_back(Key);
+        }
+      }
+    }
+  }
+
+  while (!Worklist.empty()) {
+    std::string Key = std::move(Worklist.back());
+    Worklist.pop_back();
+    for (const std::string &Caller : Callers.lookup(Key)) {
+      if (Relevant.insert(Caller).second) {
+        Worklist.push_back(Caller);
+      }
+    }
+  }
+}
+
+bool ProjectLoader::isRelevant(size_t Index, const Function &F) const {
+  if (!Opts.Prescreen || Relevant.count(functionKey(Index, F.getName(), F.hasLocalLinkage()))) {
+    return true;
+  }
+  return std::find(Opts.EntryPoints.begin(), Opts.EntryPoints.end(), F.getName()) !=
+         Opts.EntryPoints.end();
+}
+
+/// Turn the functions of M that the pre-screen rejected into declarations, so
+/// their bodies are neither imported nor analyzed and calls to them stay
+/// opaque.
+void ProjectLoader::dropIrrelevant(size_t Index, Module &M) {
+  for (Function &F : M) {
+    if (F.isDeclaration() || isRelevant(Index, F)) {
+      continue;
+    }
+    if (F.hasLocalLinkage()) {
+      // A declaration has external linkage; keep it apart from definitions of
+      // the same name in other inputs.
+      F.setName(F.getName() + ".llvm." + Twine(Index));
+    }
+    F.deleteBody();
+    F.setComdat(nullptr);
+    ++DroppedFunctions;
+  }
+}
+
+std::unique_ptr<Module> ProjectLoader::load(const std::vector<std::string> &Inputs,
+                                            LLVMContext &Context, std::string &Error) {
+  LinkedFiles = 0;
+  DroppedFunctions = 0;
+  if (!buildIndex(Inputs, Context, Error)) {
+    return nullptr;
+  }
+
+  auto Project = std::make_unique<Module>("project", Context);
+  Linker ProjectLinker(*Project);
+  std::vector<bool> Contributed(Inputs.size(), false);
+  StringSet<> Requested;
+
+  // Inputs to link next, with the symbols they are expected to resolve.
+  std::map<size_t, std::vector<std::string>> Pending;
+  for (const std::string &Entry : Opts.EntryPoints) {
+    auto It = Definitions.find(Entry);
+    if (It != Definitions.end()) {
+      Pending[It->second].push_back(Entry);
+    }
+  }
+  if (Pending.empty()) {
+    Error = "no input defines an entry point";
+    return nullptr;
+  }
+
+  auto OldHandler = Context.getDiagnosticHandlerCallBack();
+  void *OldHandlerContext = Context.getDiagnosticContext();
+  std::string LinkErrors;
+  Context.setDiagnosticHandlerCallBack(collectDiagnostic, &LinkErrors);
+
+  while (!Pending.empty()) {
+    for (auto &Entry : Pending) {
+      std::unique_ptr<Module> M = parseInput(Inputs[Entry.first], Context, Error, true);
+      if (!M) {
+        Project.reset();
+        break;
+      }
+      if (Project->getDataLayout().isDefault()) {
+        Project->setDataLayout(M->getDataLayout());
+        Project->setTargetTriple(M->getTargetTriple());
+      }
+      for (const std::string &Name : Entry.second) {
+        declareIn(*Project, *M, Name);
+        Requested.insert(Name);
+      }
+      dropIrrelevant(Entry.first, *M);
+      if (ProjectLinker.linkInModule(std::move(M), Linker::Flags::LinkOnlyNeeded)) {
+        Error = "cannot link " + Inputs[Entry.first] + ": " + LinkErrors;
+        Project.reset();
+        break;
+      }
+      Contributed[Entry.first] = true;
+    }
+    if (!Project) {
+      break;
+    }
+
+    // Whatever is still only declared may be defined by another input.
+    Pending.clear();
+    for (GlobalValue &GV : Project->global_values()) {
+      if (!GV.isDeclaration() || Requested.count(GV.getName())) {
+        continue;
+      }
+      if (Opts.Prescreen && isa<Function>(GV) && !Relevant.count(GV.getName())) {
+        continue;
+      }
+      auto It = Definitions.find(GV.getName());
+      if (It != Definitions.end()) {
+        Pending[It->second].push_back(GV.getName().str());
+      }
+    }
+  }
+
+  Context.setDiagnosticHandlerCallBack(OldHandler, OldHandlerContext);
+  LinkedFiles = std::count(Contributed.begin(), Contributed.end(), true);
+  return Project;
+}
@@ -1,48 +1,287 @@
 #include "Sarif.h"
 
-/// Add common information for all report files.
-Sarif::Sarif() {
-  GenSarif = {
-      {Runs,
-       {{{Tool,
-          {{Driver,
-            {{ToolName, "name"},
-             {InformationUri, "https://www..."},
-             {Version, "1.1.0"},
-             {Rules,
-              {{{RuleId, "buffer-overflow"},
-                {ShortDescription, {{Text, TextMsgBO}}},
-                {Uri, UriAddrBO}},
-               {{RuleId, "memory-leak"}, {ShortDescription, {{Text, TextMsgML}}}, {Uri, UriAddrML}},
-               {{RuleId, "use-after-free"},
-                {ShortDescription, {{Text, TextMsgUAF}}},
-                {Uri, UriAddrUAF}}}}}}}},
-         {Results, nlohmann::json::array()}}}},
-      {Schema, SchemaURI},
-      {Version, VersionValue}};
-}
-
-void Sarif::addResult(const BugReport &Result) {
-
-  SmallVector<nlohmann::json> LocationTrace;
-  for (auto TraceElem : Result.Trace) {
-    LocationTrace.push_back({{Location,
-                              {{Message, {{Text, "Additional information about location."}}},
-                               {PhysicalLocation,
-                                {{ArtifactLocation, {{FileUri, TraceElem.first}}},
-                                 {Region, {{StartLine, TraceElem.second}}}}}}}});
-  }
-  GenSarif[Runs.data()][0][Results.data()].push_back(
-      {{CodeFlows, {{{ThreadFlows, {{{Locations, LocationTrace}}}}}}},
-       {RuleID, Result.RuleId},
-       {RuleIndex, Result.RuleIndex},
-       {Message, {{Text, "Report message."}}},
-       {Locations,
-        {{{PhysicalLocation,
-           LocationTrace.pop_back_val().at({Location}).at({PhysicalLocation})}}}}});
-}
-
-void Sarif::save() {
-  std::ofstream FileSarif(FileName);
-  FileSarif << GenSarif.dump(2);
+namespace {
+
+const char *const Version = "version";
+const char *const Runs = "runs";
+const char *const Tool = "tool";
+const char *const Driver = "driver";
+const char *const ToolName = "name";
+const char *const Rules = "rules";
+const char *const Results = "results";
+const char *const RuleId = "id";
+const char *const Text = "text";
+const char *const ShortDescription = "shortDescription";
+const char *const Uri = "helpUri";
+const char *const FileUri = "uri";
+const char *const PhysicalLocation = "physicalLocation";
+const char *const ArtifactLocation = "artifactLocation";
+const char *const RuleID = "ruleId";
+const char *const RuleIndex = "ruleIndex";
+const char *const Locations = "locations";
+const char *const Location = "location";
+const char *const Message = "message";
+const char *const Schema = "$schema";
+const char *const CodeFlows = "codeFlows";
+const char *const ThreadFlows = "threadFlows";
+const char *const Region = "region";
+const char *const StartLine = "startLine";
+const char *const InformationUri = "informationUri";
+const char *const Invocations = "invocations";
+const char *const ExecutionSuccessful = "executionSuccessful";
+const char *const ToolExecutionNotifications = "toolExecutionNotifications";
+const char *const Level = "level";
+
+const char *const SchemaURI = "https://json.schemastore.org/sarif-2.1.0";
+const char *const VersionValue = "2.1.0";
+
+struct Rule {
+  const char *Id;
+  const char *Text;
+  const char *HelpUri;
+};
+
+const Rule RuleTable[] = {
+    {"buffer-overflow", "report if the line may occur to a buffer overflow error",
+     "https://www.acunetix.com/blog/web-security-zone/what-is-buffer-overflow/"},
+    {"memory-leak", "report if the line may occur to a memory leak error",
+     "https://aticleworld.com/what-is-memory-leak-in-c-c-how-can-we-avoid/"},
+    {"use-after-free", "report if the line may occur to a use after free",
+     "https://encyclopedia.kaspersky.com/glossary/use-after-free/"},
+};
+
+json::Value toJson(const std::string &Str) {
+  return json::isUTF8(Str) ? json::Value(Str) : json::Value(json::fixUTF8(Str));
+}
+
+void writePhysicalLocation(json::OStream &J, const std::pair<std::string, unsigned> &Step) {
+  J.attributeObject(PhysicalLocation, [&] {
+    J.attributeObject(ArtifactLocation, [&] { J.attribute(FileUri, toJson(Step.first)); });
+    J.attributeObject(Region, [&] { J.attribute(StartLine, Step.second); });
+  });
+}
+
+bool readPhysicalLocation(const json::Object &Location, std::pair<std::string, unsigned> &Step) {
+  const json::Object *Physical = Location.getObject(PhysicalLocation);
+  if (!Physical) {
+    return false;
+  }
+  const json::Object *Artifact = Physical->getObject(ArtifactLocation);
+  const json::Object *Lines = Physical->getObject(Region);
+  if (!Artifact || !Lines) {
+    return false;
+  }
+  auto File = Artifact->getString(FileUri);
+  auto Line = Lines->getInteger(StartLine);
+  if (!File || !Line) {
+    return false;
+  }
+  Step = {File->str(), static_cast<unsigned>(*Line)};
+  return true;
+}
+
+/// The first element of Object's array Key, if it is an object.
+const json::Object *getFirstObject(const json::Object &Object, StringRef Key) {
+  const json::Array *Elements = Object.getArray(Key);
+  return Elements && !Elements->empty() ? Elements->front().getAsObject() : nullptr;
+}
+
+bool readResult(const json::Object &Result, std::vector<BugReport> &Reports) {
+  auto Id = Result.getString(RuleID);
+  auto Index = Result.getInteger(RuleIndex);
+  if (!Id || !Index) {
+    return false;
+  }
+  // addResult writes the trace as the only thread flow of the only code flow.
+  SmallVector<std::pair<std::string, unsigned>> Trace;
+  const json::Object *Flow = getFirstObject(Result, CodeFlows);
+  const json::Object *Thread = Flow ? getFirstObject(*Flow, ThreadFlows) : nullptr;
+  const json::Array *Steps = Thread ? Thread->getArray(Locations) : nullptr;
+  if (Steps) {
+    for (const json::Value &Step : *Steps) {
+      const json::Object *StepObject = Step.getAsObject();
+      const json::Object *Place = StepObject ? StepObject->getObject(Location) : nullptr;
+      std::pair<std::string, unsigned> Line;
+      if (!Place || !readPhysicalLocation(*Place, Line)) {
+        return false;
+      }
+      Trace.push_back(Line);
+    }
+  }
+  Reports.emplace_back(Trace, *Id, static_cast<int>(*Index));
+  return true;
+}
+
+} // namespace
+
+bool readResults(StringRef SarifText, std::vector<BugReport> &Reports) {
+  Expected<json::Value> Log = json::parse(SarifText);
+  if (!Log) {
+    consumeError(Log.takeError());
+    return false;
+  }
+  const json::Object *LogObject = Log->getAsObject();
+  const json::Array *LogRuns = LogObject ? LogObject->getArray(Runs) : nullptr;
+  if (!LogRuns) {
+    return false;
+  }
+  for (const json::Value &Run : *LogRuns) {
+    const json::Object *RunObject = Run.getAsObject();
+    const json::Array *RunResults = RunObject ? RunObject->getArray(Results) : nullptr;
+    if (!RunResults) {
+      continue;
+    }
+    for (const json::Value &Result : *RunResults) {
+      const json::Object *ResultObject = Result.getAsObject();
+      if (!ResultObject || !readResult(*ResultObject, Reports)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+SarifWriter::SarifWriter(raw_ostream &OS, bool Compact) : OS(OS), J(OS, Compact ? 0 : 2) {
+  writeHeader();
+}
+
+SarifWriter::SarifWriter(std::unique_ptr<raw_fd_ostream> File, bool Compact)
+    : File(std::move(File)), OS(*this->File), J(OS, Compact ? 0 : 2) {
+  writeHeader();
+}
+
+SarifWriter::~SarifWriter() { finish(); }
+
+std::unique_ptr<SarifWriter> SarifWriter::create(const std::string &Path, bool Compact,
+                                                 std::string &Error) {
+  std::error_code EC;
+  auto File = std::make_unique<raw_fd_ostream>(Path, EC);
+  if (EC) {
+    Error = "cannot write " + Path + ": " + EC.message();
+    return nullptr;
+  }
+  return std::unique_ptr<SarifWriter>(new SarifWriter(std::move(File), Compact));
+}
+
+/// Add common information for all report files and open the results array.
+void SarifWriter::writeHeader() {
+  J.objectBegin();
+  J.attribute(Schema, SchemaURI);
+  J.attribute(Version, VersionValue);
+  J.attributeBegin(Runs);
+  J.arrayBegin();
+  J.objectBegin();
+  J.attributeObject(Tool, [&] {
+    J.attributeObject(Driver, [&] {
+      J.attribute(ToolName, "name");
+      J.attribute(InformationUri, "https://www...");
+      J.attribute(Version, "1.1.0");
+      J.attributeArray(Rules, [&] {
+        for (const Rule &R : RuleTable) {
+          J.object([&] {
+            J.attribute(RuleId, R.Id);
+            J.attributeObject(ShortDescription, [&] { J.attribute(Text, R.Text); });
+            J.attribute(Uri, R.HelpUri);
+          });
+        }
+      });
+    });
+  });
+  J.attributeBegin(Results);
+  J.arrayBegin();
+  J.flush();
+}
+
+void SarifWriter::addResult(const BugReport &Result) {
+  J.object([&] {
+    J.attributeArray(CodeFlows, [&] {
+      J.object([&] {
+        J.attributeArray(ThreadFlows, [&] {
+          J.object([&] {
+            J.attributeArray(Locations, [&] {
+              for (const auto &Step : Result.Trace) {
+                J.object([&] {
+                  J.attributeObject(Location, [&] {
+                    J.attributeObject(Message, [&] {
+                      J.attribute(Text, "Additional information about location.");
+                    });
+                    writePhysicalLocation(J, Step);
+                  });
+                });
+              }
+            });
+          });
+        });
+      });
+    });
+    J.attribute(RuleID, Result.RuleId);
+    J.attribute(RuleIndex, Result.RuleIndex);
+    J.attributeObject(Message, [&] { J.attribute(Text, "Report message."); });
+    J.attributeArray(Locations, [&] {
+      if (!Result.Trace.empty()) {
+        J.object([&] { writePhysicalLocation(J, Result.Trace.back()); });
+      }
+    });
+  });
+  J.flush();
+}
+
+bool SarifWriter::addResults(StringRef SarifText) {
+  Expected<json::Value> Other = json::parse(SarifText);
+  if (!Other) {
+    consumeError(Other.takeError());
+    return false;
+  }
+  const json::Object *Log = Other->getAsObject();
+  const json::Array *OtherRuns = Log ? Log->getArray(Runs) : nullptr;
+  if (!OtherRuns) {
+    return false;
+  }
+  for (const json::Value &Run : *OtherRuns) {
+    const json::Object *RunObject = Run.getAsObject();
+    const json::Array *OtherResults = RunObject ? RunObject->getArray(Results) : nullptr;
+    if (!OtherResults) {
+      continue;
+    }
+    for (const json::Value &Result : *OtherResults) {
+      J.value(Result);
+    }
+  }
+  J.flush();
+  return true;
+}
+
+void SarifWriter::addNotification(StringRef Message) {
+  Notifications.push_back(Message.str());
+}
+
+void SarifWriter::finish() {
+  if (Finished) {
+    return;
+  }
+  Finished = true;
+  J.arrayEnd();
+  J.attributeEnd();
+  if (!Notifications.empty()) {
+    J.attributeArray(Invocations, [&] {
+      J.object([&] {
+        J.attribute(ExecutionSuccessful, true);
+        J.attributeArray(ToolExecutionNotifications, [&] {
+          for (const std::string &Notification : Notifications) {
+            J.object([&] {
+              J.attribute(Level, "warning");
+              J.attributeObject(Message, [&] { J.attribute(Text, toJson(Notification)); });
+            });
+          }
+        });
+      });
+    });
+  }
+  J.objectEnd();
+  J.arrayEnd();
+  J.attributeEnd();
+  J.objectEnd();
+  J.flush();
+  OS << "\n";
+  OS.flush();
 }
@@ -1,22 +1,19 @@
 #include "SimplePass.h"
-#include "Analyzer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include <cstdlib>
+
+/// The index covers the function bodies present when it is built; findBugs
+/// rebuilds it once the analysis has materialized what it reads.
+const DebugLocIndex &SimplePass::getLocations(const Module &M) {
+  if (!Locations || &Locations->getModule() != &M) {
+    Locations = std::make_unique<DebugLocIndex>(M);
+  }
+  return *Locations;
+}
 
 std::string SimplePass::getFunctionLocation(const Function *Func) {
-  for (auto InstIt = inst_begin(Func), ItEnd = inst_end(Func); InstIt != ItEnd; ++InstIt) {
-    if (DILocation *Location = InstIt->getDebugLoc()) {
-      std::filesystem::path FilePathWithPrefix = std::filesystem::path("file://");
-      std::filesystem::path FilePath = Location->getFilename().str();
-      if (FilePath.is_absolute()) {
-        FilePathWithPrefix /= FilePath;
-        return FilePathWithPrefix.string();
-      }
-      std::filesystem::path Directory = Location->getDirectory().str();
-      Directory /= FilePath;
-      FilePathWithPrefix += Directory;
-      return FilePathWithPrefix.string();
-    }
-  }
-  return "";
+  return getLocations(*Func->getParent()).getFileUri(Func);
 }
 
 SmallVector<std::pair<std::string, unsigned>>
@@ -39,25 +36,10 @@ SimplePass::getAllFunctionsTrace(Module &M) {
 
 unsigned SimplePass::getInstructionLine(const Value *val) {
   if (auto inst = dyn_cast<Instruction>(val)) {
-    if (DILocation *Location = inst->getDebugLoc()) {
-      return Location->getLine();
-    } else {
-      const Function *Func = inst->getFunction();
-      for (auto InstIt = inst_begin(Func), ItEnd = inst_end(Func); InstIt != ItEnd; ++InstIt) {
-        if (auto *dbgDeclare = dyn_cast<DbgDeclareInst>(&*InstIt)) {
-          auto *declaredInst = dyn_cast<Instruction>(dbgDeclare->getAddress());
-          if (declaredInst && declaredInst == inst) {
-            return dbgDeclare->getDebugLoc().getLine();
-          }
-        }
-      }
-    }
-  } else if (auto* global = dyn_cast<GlobalVariable>(val)) {
-    if (auto *dig = dyn_cast<DIGlobalVariableExpression>(global->getMetadata("dbg"))) {
-      if (auto *div = dyn_cast<DIGlobalVariable>(dig->getVariable())) {
-        return div->getLine();
-      }
-    }
+    return getLocations(*inst->getModule()).getLine(inst);
+  }
+  if (auto *global = dyn_cast<GlobalVariable>(val)) {
+    return getLocations(*global->getParent()).getLine(global);
   }
   return -1;
 }
@@ -84,52 +66,161 @@ SmallVector<std::pair<std::string, unsigned>> SimplePass::createTraceOfPairInst(
   return Trace;
 }
 
-PreservedAnalyses SimplePass::run(Module &M, ModuleAnalysisManager &) {
-  analyze(M);
+/// Whether the environment variable Name is set to anything but an empty
+/// string, "0" or "false".
+static bool getEnvFlag(const char *Name) {
+  const char *Value = std::getenv(Name);
+  if (!Value) {
+    return false;
+  }
+  StringRef Flag(Value);
+  return !Flag.empty() && Flag != "0" && Flag != "false";
+}
+
+/// The FuncInfos come from the function analysis manager, so they are shared
+/// with other passes of the pipeline and kept until a pass invalidates them.
+PreservedAnalyses SimplePass::run(Module &M, ModuleAnalysisManager &MAM) {
+  analyze(M, &MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager());
   return PreservedAnalyses::all();
 }
 
-void SimplePass::analyze(Module &M) {
-  if (M.getFunctionList().empty()) {
+/// The report is written without indentation if ANALYZER_COMPACT_REPORT is
+/// set, and ANALYZER_TIME_BUDGET bounds the seconds spent on the module.
+/// ANALYZER_PRESCREEN skips the functions without relevant operations, and
+/// ANALYZER_SLICE builds their graphs over the slice only.
+/// ANALYZER_INLINE_HELPERS inlines the helpers up to that size first.
+void SimplePass::analyze(Module &M, FunctionAnalysisManager *FAM) {
+  // Translation units without main have nothing to report, and writing one
+  // would replace the report of the unit that has it.
+  Function *Main = M.getFunction("main");
+  if (!Main || Main->isDeclaration()) {
     return;
   }
 
-  Sarif GenSarif;
+  // Open the report first, so that it is well formed up to the last result
+  // even if the analysis never returns.
+  std::string Error;
+  auto Writer = SarifWriter::create(getReportPath(M), getEnvFlag("ANALYZER_COMPACT_REPORT"), Error);
+  if (!Writer) {
+    errs() << "error: " << Error << "\n";
+    return;
+  }
+  AnalyzerOptions Options;
+  if (const char *Budget = std::getenv("ANALYZER_TIME_BUDGET")) {
+    Options.timeBudget = std::atof(Budget);
+  }
+  Options.prescreen = getEnvFlag("ANALYZER_PRESCREEN");
+  Options.slice = getEnvFlag("ANALYZER_SLICE");
+  if (const char *Threshold = std::getenv("ANALYZER_INLINE_HELPERS")) {
+    Options.inlineThreshold = std::strtoul(Threshold, nullptr, 10);
+  }
+  if (FAM) {
+    Options.funcInfoProvider = [FAM](Function &F) { return FAM->getResult<FuncInfoAnalysis>(F).GetFuncInfo(); };
+  }
+  std::vector<std::string> Truncated;
+  Options.onTruncated = [&Truncated](const std::string &What) { Truncated.push_back(What); };
+  findBugs(M, Options, [&Writer](const BugReport &Report) { Writer->addResult(Report); });
+  for (const std::string &What : Truncated) {
+    Writer->addNotification(What);
+  }
+}
+
+/// ANALYZER_REPORT names the report file; ANALYZER_REPORT_DIR collects one
+/// report per translation unit, named after its source file.
+std::string SimplePass::getReportPath(const Module &M) {
+  if (const char *Path = std::getenv("ANALYZER_REPORT")) {
+    return Path;
+  }
+  const char *Dir = std::getenv("ANALYZER_REPORT_DIR");
+  if (!Dir) {
+    return "report.sarif";
+  }
+  sys::fs::create_directories(Dir);
+  StringRef Source = M.getSourceFileName().empty() ? M.getModuleIdentifier() : M.getSourceFileName();
+  SmallString<256> Path(Dir);
+  sys::path::append(Path, sys::path::filename(Source) + ".sarif");
+  return Path.str().str();
+}
+
+std::vector<BugReport> SimplePass::findBugs(Module &M, const AnalyzerOptions &Options,
+                                            const std::function<void(const BugReport &)> &OnReport) {
+  // Translation units compiled without main have no entry point to start from.
+  Function *Main = M.getFunction("main");
+  if (!Main || Main->isDeclaration()) {
+    return {};
+  }
 
-  auto analyzer = std::make_shared<Analyzer>(M);
-  auto mlLoc = analyzer->MLCheck();
+  // Index once the Analyzer has materialized the functions reachable from
+  // main, so that the traces below see their debug locations. In debug-lite
+  // mode that is before it strips them.
+  AnalyzerOptions Analysis = Options;
+  Analysis.onMaterialized = [this, &Options](Module &Materialized) {
+    Locations = std::make_unique<DebugLocIndex>(Materialized, Options.stripDebugInfo);
+    if (Options.onMaterialized) {
+      Options.onMaterialized(Materialized);
+    }
+  };
+  auto analyzer = std::make_shared<Analyzer>(M, Analysis);
+  size_t checks = Options.mlCheck + Options.uafCheck + Options.bofCheck;
+  size_t checksDone = 0;
+
+  auto mlLoc = Options.mlCheck ? analyzer->MLCheck() : nullptr;
+  if (Options.mlCheck) {
+    analyzer->ReportProgress("checks", ++checksDone, checks);
+  }
   if (mlLoc) {
     errs() << mlLoc->getType().first << ": " << *mlLoc->getTrace().first << "|" << *mlLoc->getTrace().second << "\n";
     auto Trace = createTraceOfPairInst(mlLoc->getTrace().first, mlLoc->getTrace().second);
-    GenSarif.addResult(BugReport(Trace, mlLoc->getType().first, mlLoc->getType().second));
-    GenSarif.save();
-    return;
+    BugReport Report(Trace, mlLoc->getType().first, mlLoc->getType().second);
+    if (OnReport) {
+      OnReport(Report);
+    }
+    return {Report};
   }
 
-  auto uafLoc = analyzer->UAFCheck();
+  auto uafLoc = Options.uafCheck ? analyzer->UAFCheck() : nullptr;
+  if (Options.uafCheck) {
+    analyzer->ReportProgress("checks", ++checksDone, checks);
+  }
   if (uafLoc) {
     errs() << uafLoc->getType().first << ": " << *uafLoc->getTrace().first << "|" << *uafLoc->getTrace().second << "\n";
     auto Trace = createTraceOfPairInst(uafLoc->getTrace().first, uafLoc->getTrace().second);
-    GenSarif.addResult(BugReport(Trace, uafLoc->getType().first, uafLoc->getType().second));
-    GenSarif.save();
-    return;
+    BugReport Report(Trace, uafLoc->getType().first, uafLoc->getType().second);
+    if (OnReport) {
+      OnReport(Report);
+    }
+    return {Report};
   }
 
-  auto bofLoc = analyzer->BOFCheck();
+  auto bofLoc = Options.bofCheck ? analyzer->BOFCheck() : nullptr;
+  if (Options.bofCheck) {
+    analyzer->ReportProgress("checks", ++checksDone, checks);
+  }
   if (bofLoc) {
     errs() << bofLoc->getType().first << ": " << *bofLoc->getTrace().first << "|" << *bofLoc->getTrace().second << "\n";
     auto Trace = createTraceOfPairInst(bofLoc->getTrace().first, bofLoc->getTrace().second);
-    GenSarif.addResult(BugReport(Trace, bofLoc->getType().first, bofLoc->getType().second));
-    GenSarif.save();
-    return;
+    BugReport Report(Trace, bofLoc->getType().first, bofLoc->getType().second);
+    if (OnReport) {
+      OnReport(Report);
+    }
+    return {Report};
   }
 
-  GenSarif.save();
+  return {};
 }
 
-/// Register the pass.
+/// Register FuncInfoAnalysis with the function analysis managers, and the
+/// pass both as "simple" for opt -passes and at the start of the default
+/// pipelines, so that clang -fpass-plugin analyzes each translation unit in
+/// memory. The checkers expect unoptimized IR, hence PipelineStartEP rather
+/// than OptimizerLastEP.
 extern "C" ::llvm::PassPluginLibraryInfo LLVM_ATTRIBUTE_WEAK llvmGetPassPluginInfo() {
   return {LLVM_PLUGIN_API_VERSION, "simple", LLVM_VERSION_STRING, [](PassBuilder &PB) {
+    PB.registerAnalysisRegistrationCallback([](FunctionAnalysisManager &FAM) {
+      FAM.registerPass([] { return FuncInfoAnalysis(getEnvFlag("ANALYZER_SLICE")); });
+    });
+    PB.registerPipelineStartEPCallback(
+        [](ModulePassManager &MPM, auto) { MPM.addPass(SimplePass()); });
     PB.registerPipelineParsingCallback([&](StringRef Name, ModulePassManager &MPM,
                                            ArrayRef<PassBuilder::PipelineElement>) {
       if (Name == "simple") {
@@ -0,0 +1,190 @@
+#include "Socket.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+bool isUnixAddress(StringRef Address) { return Address.startswith("unix:"); }
+
+int openUnixSocket(StringRef Path, bool Listen, std::string &Error) {
+  sockaddr_un Addr = {};
+  Addr.sun_family = AF_UNIX;
+  if (Path.size() >= sizeof(Addr.sun_path)) {
+    Error = "socket path is too long";
+    return -1;
+  }
+  std::memcpy(Addr.sun_path, Path.data(), Path.size());
+
+  int Fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (Fd < 0) {
+    Error = std::strerror(errno);
+    return -1;
+  }
+  if (Listen) {
+    unlink(Addr.sun_path);
+    if (bind(Fd, reinterpret_cast<sockaddr *>(&Addr), sizeof(Addr)) == 0 &&
+        listen(Fd, SOMAXCONN) == 0) {
+      return Fd;
+    }
+  } else if (connect(Fd, reinterpret_cast<sockaddr *>(&Addr), sizeof(Addr)) == 0) {
+    return Fd;
+  }
+  Error = std::strerror(errno);
+  ::close(Fd);
+  return -1;
+}
+
+int openTCPSocket(StringRef Address, bool Listen, std::string &Error) {
+  auto HostPort = Address.rsplit(':');
+  if (HostPort.second.empty()) {
+    Error = "expected <host>:<port>";
+    return -1;
+  }
+  std::string Host = HostPort.first.str();
+  std::string Port = HostPort.second.str();
+
+  addrinfo Hints = {};
+  Hints.ai_family = AF_UNSPEC;
+  Hints.ai_socktype = SOCK_STREAM;
+  Hints.ai_flags = Listen ? AI_PASSIVE : 0;
+  addrinfo *Infos = nullptr;
+  if (int Status = getaddrinfo(Host.empty() ? nullptr : Host.c_str(), Port.c_str(), &Hints, &Infos)) {
+    Error = gai_strerror(Status);
+    return -1;
+  }
+
+  int Fd = -1;
+  for (addrinfo *Info = Infos; Info; Info = Info->ai_next) {
+    Fd = socket(Info->ai_family, Info->ai_socktype, Info->ai_protocol);
+    if (Fd < 0) {
+      continue;
+    }
+    if (Listen) {
+      int Reuse = 1;
+      setsockopt(Fd, SOL_SOCKET, SO_REUSEADDR, &Reuse, sizeof(Reuse));
+      if (bind(Fd, Info->ai_addr, Info->ai_addrlen) == 0 && listen(Fd, SOMAXCONN) == 0) {
+        break;
+      }
+    } else if (connect(Fd, Info->ai_addr, Info->ai_addrlen) == 0) {
+      break;
+    }
+    Error = std::strerror(errno);
+    ::close(Fd);
+    Fd = -1;
+  }
+  freeaddrinfo(Infos);
+  return Fd;
+}
+
+} // namespace
+
+int listenOn(StringRef Address, std::string &Error) {
+  if (isUnixAddress(Address)) {
+    return openUnixSocket(Address.drop_front(5), true, Error);
+  }
+  return openTCPSocket(Address, true, Error);
+}
+
+int connectTo(StringRef Address, std::string &Error) {
+  if (isUnixAddress(Address)) {
+    return openUnixSocket(Address.drop_front(5), false, Error);
+  }
+  return openTCPSocket(Address, false, Error);
+}
+
+MessageStream::~MessageStream() { close(); }
+
+void MessageStream::close() {
+  if (Fd >= 0) {
+    ::close(Fd);
+    Fd = -1;
+  }
+}
+
+bool MessageStream::send(const std::vector<std::string> &Args, StringRef Payload) {
+  std::string Frame;
+  for (const std::string &Arg : Args) {
+    Frame += Arg + " ";
+  }
+  Frame += std::to_string(Payload.size()) + "\n";
+  Frame += Payload.str();
+
+  std::lock_guard<std::mutex> Lock(SendMutex);
+  size_t Sent = 0;
+  while (Fd >= 0 && Sent < Frame.size()) {
+    ssize_t Written = ::send(Fd, Frame.data() + Sent, Frame.size() - Sent, MSG_NOSIGNAL);
+    if (Written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (Written <= 0) {
+      return false;
+    }
+    Sent += static_cast<size_t>(Written);
+  }
+  return Sent == Frame.size();
+}
+
+/// Move the first complete message out of the buffer, if there is one.
+bool MessageStream::takeMessage(Message &Msg) {
+  size_t LineEnd = Buffer.find('\n');
+  if (LineEnd == std::string::npos) {
+    return false;
+  }
+
+  SmallVector<StringRef, 4> Words;
+  StringRef(Buffer.data(), LineEnd).split(Words, ' ', -1, false);
+  size_t PayloadSize = 0;
+  if (Words.empty() || Words.back().getAsInteger(10, PayloadSize)) {
+    // Malformed header; drop the line.
+    Buffer.erase(0, LineEnd + 1);
+    return takeMessage(Msg);
+  }
+  if (Buffer.size() < LineEnd + 1 + PayloadSize) {
+    return false;
+  }
+
+  Msg.Args.clear();
+  for (StringRef Word : makeArrayRef(Words).drop_back()) {
+    Msg.Args.push_back(Word.str());
+  }
+  Msg.Payload = Buffer.substr(LineEnd + 1, PayloadSize);
+  Buffer.erase(0, LineEnd + 1 + PayloadSize);
+  return true;
+}
+
+bool MessageStream::receive(Message &Msg) {
+  while (!takeMessage(Msg)) {
+    char Chunk[65536];
+    ssize_t Read = recv(Fd, Chunk, sizeof(Chunk), 0);
+    if (Read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (Read <= 0) {
+      return false;
+    }
+    Buffer.append(Chunk, static_cast<size_t>(Read));
+  }
+  return true;
+}
+
+bool MessageStream::poll(std::vector<Message> &Received) {
+  char Chunk[65536];
+  ssize_t Read = recv(Fd, Chunk, sizeof(Chunk), MSG_DONTWAIT);
+  if (Read == 0 || (Read < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+    return false;
+  }
+  if (Read > 0) {
+    Buffer.append(Chunk, static_cast<size_t>(Read));
+  }
+  Message Msg;
+  while (takeMessage(Msg)) {
+    Received.push_back(std::move(Msg));
+  }
+  return true;
+}
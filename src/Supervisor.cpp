@@ -0,0 +1,291 @@
+#include "Supervisor.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+/// Message sent from a worker to the supervisor through its pipe.
+struct ShardMessage {
+  enum Kind : uint32_t { Started, Done, ParseError };
+  uint32_t Index;
+  uint32_t What;
+};
+
+size_t getResidentMB(pid_t Pid) {
+  std::ifstream Statm("/proc/" + std::to_string(Pid) + "/statm");
+  size_t Size = 0;
+  size_t Resident = 0;
+  if (!(Statm >> Size >> Resident)) {
+    return 0;
+  }
+  return Resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) / (1024 * 1024);
+}
+
+const char *getStatusName(Supervisor::Status S) {
+  switch (S) {
+  case Supervisor::Status::Pending:return "not analyzed";
+  case Supervisor::Status::Done:return "done";
+  case Supervisor::Status::ParseError:return "parse error";
+  case Supervisor::Status::Crashed:return "worker crashed";
+  case Supervisor::Status::TimedOut:return "timed out";
+  case Supervisor::Status::OutOfMemory:return "memory limit exceeded";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+Supervisor::Supervisor(std::vector<std::string> Inputs, Options Opts)
+    : Inputs(std::move(Inputs)), Opts(std::move(Opts)) {}
+
+std::string Supervisor::getResultPath(size_t Index) const {
+  return Opts.ShardDir + "/" + std::to_string(Index) + ".sarif";
+}
+
+bool Supervisor::spawn(Worker &W) {
+  int Fds[2];
+  if (pipe(Fds) != 0) {
+    return false;
+  }
+  pid_t Pid = fork();
+  if (Pid < 0) {
+    close(Fds[0]);
+    close(Fds[1]);
+    return false;
+  }
+  if (Pid == 0) {
+    close(Fds[0]);
+    for (Worker &Other : Workers) {
+      if (Other.Fd >= 0) {
+        close(Other.Fd);
+      }
+    }
+    W.Fd = Fds[1];
+    runShard(W);
+  }
+
+  close(Fds[1]);
+  W.Pid = Pid;
+  W.Fd = Fds[0];
+  W.Current = -1;
+  W.KillReason = Status::Crashed;
+  W.Pending.clear();
+  return true;
+}
+
+/// Body of a worker process. Reports progress so the supervisor knows which
+/// input to blame if the process dies.
+void Supervisor::runShard(Worker &W) {
+  for (size_t Index : W.Shard) {
+    ShardMessage Msg{static_cast<uint32_t>(Index), ShardMessage::Started};
+    if (write(W.Fd, &Msg, sizeof(Msg)) != sizeof(Msg)) {
+      _exit(1);
+    }
+
+    InputResult Result = analyzeFile(Inputs[Index], Opts.LazyLoad, nullptr, Opts.Analysis);
+    if (Result.failed()) {
+      errs() << "error: " << Result.Error << "\n";
+      Msg.What = ShardMessage::ParseError;
+    } else {
+      // Shard results are only read back by writeMergedReport.
+      std::string Error;
+      if (auto Writer = SarifWriter::create(getResultPath(Index), true, Error)) {
+        for (const BugReport &Report : Result.Reports) {
+          Writer->addResult(Report);
+        }
+      } else {
+        errs() << "error: " << Error << "\n";
+      }
+      Msg.What = ShardMessage::Done;
+    }
+    if (write(W.Fd, &Msg, sizeof(Msg)) != sizeof(Msg)) {
+      _exit(1);
+    }
+  }
+  _exit(0);
+}
+
+void Supervisor::readMessages(Worker &W) {
+  char Buffer[4096];
+  ssize_t Read = read(W.Fd, Buffer, sizeof(Buffer));
+  if (Read <= 0) {
+    reap(W);
+    return;
+  }
+  W.Pending.append(Buffer, static_cast<size_t>(Read));
+
+  while (W.Pending.size() >= sizeof(ShardMessage)) {
+    ShardMessage Msg;
+    std::memcpy(&Msg, W.Pending.data(), sizeof(Msg));
+    W.Pending.erase(0, sizeof(Msg));
+
+    if (Msg.What == ShardMessage::Started) {
+      W.Current = Msg.Index;
+      W.Started = std::chrono::steady_clock::now();
+      continue;
+    }
+    Statuses[Msg.Index] = Msg.What == ShardMessage::Done ? Status::Done : Status::ParseError;
+    if (!W.Shard.empty() && W.Shard.front() == Msg.Index) {
+      W.Shard.pop_front();
+    }
+    W.Current = -1;
+  }
+}
+
+/// Collect a worker that closed its pipe and restart it on the rest of its
+/// shard if it died in the middle of an input.
+void Supervisor::reap(Worker &W) {
+  close(W.Fd);
+  W.Fd = -1;
+  int WaitStatus = 0;
+  waitpid(W.Pid, &WaitStatus, 0);
+  W.Pid = -1;
+
+  if (W.Shard.empty()) {
+    return;
+  }
+
+  // A worker that died between inputs is blamed on the next one, so every
+  // restart makes progress.
+  size_t Index = W.Current < 0 ? W.Shard.front() : static_cast<size_t>(W.Current);
+  Statuses[Index] = W.KillReason;
+  errs() << "error: " << Inputs[Index] << ": " << getStatusName(W.KillReason);
+  if (WIFSIGNALED(WaitStatus)) {
+    errs() << " (signal " << WTERMSIG(WaitStatus) << ")";
+  }
+  errs() << "\n";
+
+  if (!W.Shard.empty() && W.Shard.front() == Index) {
+    W.Shard.pop_front();
+  }
+  if (!W.Shard.empty() && !spawn(W)) {
+    errs() << "error: cannot restart worker\n";
+  }
+}
+
+void Supervisor::enforceLimits(Worker &W) {
+  if (W.Pid < 0 || W.Current < 0) {
+    return;
+  }
+  if (Opts.TimeoutSec &&
+      std::chrono::steady_clock::now() - W.Started > std::chrono::seconds(Opts.TimeoutSec)) {
+    W.KillReason = Status::TimedOut;
+    kill(W.Pid, SIGKILL);
+    return;
+  }
+  if (Opts.MaxRSSMB && getResidentMB(W.Pid) > Opts.MaxRSSMB) {
+    W.KillReason = Status::OutOfMemory;
+    kill(W.Pid, SIGKILL);
+  }
+}
+
+void Supervisor::writeMergedReport() {
+  std::string Error;
+  std::unique_ptr<SarifWriter> Writer;
+  if (!Opts.MergedOutput.empty()) {
+    Writer = SarifWriter::create(Opts.MergedOutput, Opts.Compact, Error);
+    if (!Writer) {
+      errs() << "error: " << Error << "\n";
+    }
+  }
+  std::unique_ptr<FindingsLogWriter> LogWriter;
+  if (!Opts.FindingsLog.empty()) {
+    LogWriter = FindingsLogWriter::create(Opts.FindingsLog, Error);
+    if (!LogWriter) {
+      errs() << "error: " << Error << "\n";
+    }
+  }
+  if (!Writer && !LogWriter) {
+    return;
+  }
+
+  for (size_t I = 0; I < Inputs.size(); ++I) {
+    if (Statuses[I] != Status::Done) {
+      continue;
+    }
+    auto Buffer = MemoryBuffer::getFile(getResultPath(I));
+    std::vector<BugReport> Reports;
+    if (!Buffer || (Writer && !Writer->addResults((*Buffer)->getBuffer())) ||
+        (LogWriter && !readResults((*Buffer)->getBuffer(), Reports))) {
+      errs() << "error: cannot merge results of " << Inputs[I] << "\n";
+      continue;
+    }
+    for (const BugReport &Report : Reports) {
+      LogWriter->add(Inputs[I], Report);
+    }
+  }
+  if (LogWriter) {
+    LogWriter->flush();
+  }
+}
+
+unsigned Supervisor::run() {
+  Statuses.assign(Inputs.size(), Status::Pending);
+
+  bool TemporaryDir = Opts.ShardDir.empty();
+  if (TemporaryDir) {
+    SmallString<128> Dir;
+    if (sys::fs::createUniqueDirectory("analyzer-shards", Dir)) {
+      errs() << "error: cannot create shard directory\n";
+      return Inputs.size();
+    }
+    Opts.ShardDir = Dir.str().str();
+  } else {
+    sys::fs::create_directories(Opts.ShardDir);
+  }
+
+  size_t NumWorkers = std::min<size_t>(std::max(1u, Opts.Workers), std::max<size_t>(1, Inputs.size()));
+  Workers.assign(NumWorkers, {});
+  for (size_t I = 0; I < Inputs.size(); ++I) {
+    Workers[I % NumWorkers].Shard.push_back(I);
+  }
+  for (Worker &W : Workers) {
+    if (!W.Shard.empty() && !spawn(W)) {
+      errs() << "error: cannot start worker\n";
+    }
+  }
+
+  while (true) {
+    std::vector<pollfd> Fds;
+    std::vector<Worker *> Polled;
+    for (Worker &W : Workers) {
+      if (W.Fd >= 0) {
+        Fds.push_back({W.Fd, POLLIN, 0});
+        Polled.push_back(&W);
+      }
+    }
+    if (Fds.empty()) {
+      break;
+    }
+
+    if (poll(Fds.data(), Fds.size(), 100) > 0) {
+      for (size_t I = 0; I < Fds.size(); ++I) {
+        if (Fds[I].revents & (POLLIN | POLLHUP | POLLERR)) {
+          readMessages(*Polled[I]);
+        }
+      }
+    }
+    for (Worker &W : Workers) {
+      enforceLimits(W);
+    }
+  }
+
+  writeMergedReport();
+  if (TemporaryDir) {
+    sys::fs::remove_directories(Opts.ShardDir);
+  }
+
+  unsigned Failed = 0;
+  for (size_t I = 0; I < Inputs.size(); ++I) {
+    if (Statuses[I] != Status::Done) {
+      ++Failed;
+    }
+  }
+  return Failed;
+}
@@ -0,0 +1,173 @@
+#include "AnalysisCache.h"
+#include "Check.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+
+/// main frees an allocation and stores through it; unused is never called.
+static const char *UseAfterFree = R"(
+declare noalias i8* @malloc(i64)
+declare void @free(i8*)
+
+define void @release(i8* %q) {
+entry:
+  call void @free(i8* %q)
+  ret void
+}
+
+define i32 @unused() {
+entry:
+  ret i32 1
+}
+
+define i32 @main() {
+entry:
+  %p = alloca i32*, align 8
+  %call = call noalias i8* @malloc(i64 4)
+  %0 = bitcast i8* %call to i32*
+  store i32* %0, i32** %p, align 8
+  %1 = load i32*, i32** %p, align 8
+  %2 = bitcast i32* %1 to i8*
+  call void @free(i8* %2)
+  %3 = load i32*, i32** %p, align 8
+  store i32 5, i32* %3, align 4
+  ret i32 0
+}
+)";
+
+static std::unique_ptr<Module> parse(StringRef Text, LLVMContext &Context) {
+  SMDiagnostic Diag;
+  std::unique_ptr<Module> M = parseIR(MemoryBufferRef(Text, "test.ll"), Diag, Context);
+  CHECK(M);
+  return M;
+}
+
+static bool sameReports(const std::vector<BugReport> &LHS, const std::vector<BugReport> &RHS) {
+  if (LHS.size() != RHS.size()) {
+    return false;
+  }
+  for (size_t I = 0; I < LHS.size(); ++I) {
+    if (LHS[I].RuleId != RHS[I].RuleId || LHS[I].RuleIndex != RHS[I].RuleIndex ||
+        LHS[I].Trace != RHS[I].Trace) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static AnalysisCache::Key makeKey(uint8_t Seed) {
+  AnalysisCache::Key K;
+  for (size_t I = 0; I < K.size(); ++I) {
+    K[I] = Seed + I;
+  }
+  return K;
+}
+
+static void testSaveLoad() {
+  TempDir Dir;
+  std::string Path = Dir.path("analyzer.cache");
+  std::vector<BugReport> Reports = {
+      BugReport({{"file:///a.c", 3}, {"file:///a.c", 7}}, "memory-leak", 1),
+      BugReport({}, "buffer-overflow", 0),
+  };
+  {
+    AnalysisCache Cache;
+    CHECK(Cache.load(Path));
+    Cache.insert(makeKey(1), Reports);
+    CHECK(Cache.save(Path));
+  }
+  {
+    // Entries read from the file are kept when new ones are saved with them.
+    AnalysisCache Cache;
+    CHECK(Cache.load(Path));
+    std::vector<BugReport> Loaded;
+    CHECK(Cache.lookup(makeKey(1), Loaded));
+    CHECK(sameReports(Loaded, Reports));
+    Cache.insert(makeKey(2), {});
+    CHECK(Cache.save(Path));
+  }
+  AnalysisCache Cache;
+  CHECK(Cache.load(Path));
+  std::vector<BugReport> Loaded;
+  CHECK(Cache.lookup(makeKey(1), Loaded));
+  CHECK(sameReports(Loaded, Reports));
+  CHECK(Cache.lookup(makeKey(2), Loaded));
+  CHECK(Loaded.empty());
+  CHECK(!Cache.lookup(makeKey(3), Loaded));
+  CHECK(Cache.getHits() == 2);
+  CHECK(Cache.getMisses() == 1);
+}
+
+static void testCorruptFile() {
+  TempDir Dir;
+  std::string Path = Dir.path("analyzer.cache");
+  {
+    AnalysisCache Cache;
+    Cache.insert(makeKey(1), {BugReport({{"file:///a.c", 3}}, "memory-leak", 1)});
+    CHECK(Cache.save(Path));
+  }
+  auto Full = MemoryBuffer::getFile(Path);
+  CHECK(Full);
+  if (!Full) {
+    return;
+  }
+  writeFile(Path, (*Full)->getBuffer().drop_back(2));
+  AnalysisCache Cache;
+  CHECK(!Cache.load(Path));
+  std::vector<BugReport> Loaded;
+  CHECK(!Cache.lookup(makeKey(1), Loaded));
+}
+
+static void testKeys() {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parse(UseAfterFree, Context);
+  std::unique_ptr<Module> Same = parse(UseAfterFree, Context);
+  AnalysisCache::Key K = AnalysisCache::computeKey(*M, {});
+  CHECK(K == AnalysisCache::computeKey(*Same, {}));
+
+  AnalyzerOptions Options;
+  Options.uafCheck = false;
+  CHECK(K != AnalysisCache::computeKey(*M, Options));
+
+  // Functions main does not reach are not part of the key.
+  std::string Text = UseAfterFree;
+  std::string Unreached = Text;
+  Unreached.replace(Unreached.find("ret i32 1"), 9, "ret i32 2");
+  CHECK(K == AnalysisCache::computeKey(*parse(Unreached, Context), {}));
+
+  std::string Reached = Text;
+  Reached.replace(Reached.find("@malloc(i64 4)"), 14, "@malloc(i64 8)");
+  CHECK(K != AnalysisCache::computeKey(*parse(Reached, Context), {}));
+}
+
+static void testFindBugs() {
+  LLVMContext Context;
+  AnalysisCache Cache;
+  std::vector<BugReport> First = Cache.findBugs(*parse(UseAfterFree, Context));
+  CHECK(First.size() == 1);
+  CHECK(Cache.getMisses() == 1);
+
+  // A hit returns the same findings and still streams them.
+  size_t Streamed = 0;
+  std::vector<BugReport> Second =
+      Cache.findBugs(*parse(UseAfterFree, Context), {}, [&Streamed](const BugReport &) { ++Streamed; });
+  CHECK(Cache.getHits() == 1);
+  CHECK(sameReports(First, Second));
+  CHECK(Streamed == 1);
+
+  // A cancelled analysis is not remembered.
+  AnalyzerOptions Options;
+  Options.mlCheck = false;
+  Options.isCancelled = [] { return true; };
+  Cache.findBugs(*parse(UseAfterFree, Context), Options);
+  std::vector<BugReport> Reports;
+  Options.isCancelled = nullptr;
+  CHECK(!Cache.lookup(AnalysisCache::computeKey(*parse(UseAfterFree, Context), Options), Reports));
+}
+
+int main() {
+  testSaveLoad();
+  testCorruptFile();
+  testKeys();
+  testFindBugs();
+  return Failures != 0;
+}
@@ -0,0 +1,116 @@
+#include "AnalyzerAPI.h"
+#include "Check.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+
+/// -O0 code that frees an allocation and then stores through it.
+static const char *UseAfterFree = R"(
+declare noalias i8* @malloc(i64)
+declare void @free(i8*)
+
+define i32 @main() {
+entry:
+  %retval = alloca i32, align 4
+  %p = alloca i32*, align 8
+  store i32 0, i32* %retval, align 4
+  %call = call noalias i8* @malloc(i64 4)
+  %0 = bitcast i8* %call to i32*
+  store i32* %0, i32** %p, align 8
+  %1 = load i32*, i32** %p, align 8
+  %2 = bitcast i32* %1 to i8*
+  call void @free(i8* %2)
+  %3 = load i32*, i32** %p, align 8
+  store i32 5, i32* %3, align 4
+  ret i32 0
+}
+)";
+
+/// The same allocation freed before anything else happens to it.
+static const char *Clean = R"(
+declare i8* @malloc(i64)
+declare void @free(i8*)
+
+define i32 @main() {
+entry:
+  %retval = alloca i32
+  %p = alloca i8*
+  store i32 0, i32* %retval
+  %call = call i8* @malloc(i64 10)
+  store i8* %call, i8** %p
+  %0 = load i8*, i8** %p
+  call void @free(i8* %0)
+  ret i32 0
+}
+)";
+
+static std::string print(const Module &M) {
+  std::string Text;
+  raw_string_ostream OS(Text);
+  M.print(OS, nullptr);
+  return OS.str();
+}
+
+static void testFindings() {
+  LLVMContext Context;
+  SMDiagnostic Diag;
+  std::unique_ptr<Module> M = parseIR(MemoryBufferRef(UseAfterFree, "uaf.ll"), Diag, Context);
+  CHECK(M);
+
+  AnalysisResult Result = analyzeModule(*M);
+  CHECK(!Result.Cancelled);
+  CHECK(Result.Error.empty());
+  CHECK(Result.Findings.size() == 1);
+  if (!Result.Findings.empty()) {
+    CHECK(Result.Findings[0].RuleId == "use-after-free");
+  }
+
+  // Only the use-after-free checker runs, and it finds the same problem.
+  AnalysisOptions Options;
+  Options.Analysis.mlCheck = false;
+  Options.Analysis.bofCheck = false;
+  Result = analyzeModule(*M, Options);
+  CHECK(Result.Findings.size() == 1);
+}
+
+static void testModuleUnchanged() {
+  LLVMContext Context;
+  SMDiagnostic Diag;
+  std::unique_ptr<Module> M = parseIR(MemoryBufferRef(Clean, "clean.ll"), Diag, Context);
+  CHECK(M);
+  std::string Before = print(*M);
+
+  // Every checker runs, including the one that renames values.
+  AnalysisResult Result = analyzeModule(*M);
+  CHECK(Result.Findings.empty());
+  CHECK(print(*M) == Before);
+}
+
+static void testCancellation() {
+  AnalysisOptions Options;
+  Options.IsCancelled = [] { return true; };
+  AnalysisResult Result = analyzeBuffer(MemoryBufferRef(UseAfterFree, "uaf.ll"), Options);
+  CHECK(Result.Cancelled);
+  CHECK(Result.Findings.empty());
+
+  // A callback that turns true later stops the analysis before the checkers
+  // are done, and nothing partial is returned.
+  int Calls = 0;
+  Options.IsCancelled = [&Calls] { return ++Calls > 1; };
+  Result = analyzeBuffer(MemoryBufferRef(UseAfterFree, "uaf.ll"), Options);
+  CHECK(Result.Cancelled);
+  CHECK(Result.Findings.empty());
+}
+
+static void testParseError() {
+  AnalysisResult Result = analyzeBuffer(MemoryBufferRef("define i32 @main(", "bad.ll"));
+  CHECK(!Result.Error.empty());
+  CHECK(Result.Findings.empty());
+}
+
+int main() {
+  testFindings();
+  testModuleUnchanged();
+  testCancellation();
+  testParseError();
+  return Failures != 0;
+}
@@ -0,0 +1,45 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+
+/// Number of failed checks; a test's main returns it.
+static int Failures = 0;
+
+/// Report a failed condition and keep going, so one run shows every failure.
+#define CHECK(Cond)                                                                                \
+  do {                                                                                             \
+    if (!(Cond)) {                                                                                 \
+      llvm::errs() << __FILE__ << ":" << __LINE__ << ": check failed: " #Cond "\n";               \
+      ++Failures;                                                                                  \
+    }                                                                                              \
+  } while (false)
+
+/// A fresh directory for the files of one test, removed with its contents.
+class TempDir {
+public:
+  TempDir() { llvm::sys::fs::createUniqueDirectory("analyzer-test", Dir); }
+  ~TempDir() { llvm::sys::fs::remove_directories(Dir); }
+
+  std::string path(llvm::StringRef Name) const {
+    llvm::SmallString<128> Path(Dir);
+    llvm::sys::path::append(Path, Name);
+    return Path.str().str();
+  }
+
+private:
+  llvm::SmallString<128> Dir;
+};
+
+/// Write Text to Path, replacing it.
+inline void writeFile(const std::string &Path, llvm::StringRef Text) {
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC);
+  OS << Text;
+}
+
+#endif // CHECK_H
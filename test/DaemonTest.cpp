@@ -0,0 +1,78 @@
+#include "Check.h"
+#include "Daemon.h"
+#include <thread>
+#include <unistd.h>
+
+static const char *UseAfterFree = R"(
+declare noalias i8* @malloc(i64)
+declare void @free(i8*)
+
+define i32 @main() {
+entry:
+  %p = alloca i32*, align 8
+  %call = call noalias i8* @malloc(i64 4)
+  %0 = bitcast i8* %call to i32*
+  store i32* %0, i32** %p, align 8
+  %1 = load i32*, i32** %p, align 8
+  %2 = bitcast i32* %1 to i8*
+  call void @free(i8* %2)
+  %3 = load i32*, i32** %p, align 8
+  store i32 5, i32* %3, align 4
+  ret i32 0
+}
+)";
+
+/// Connect once the daemon listens, or give up after a few seconds.
+static int waitForDaemon(StringRef Address) {
+  std::string Error;
+  for (int Attempt = 0; Attempt < 100; ++Attempt) {
+    int Fd = connectTo(Address, Error);
+    if (Fd >= 0) {
+      return Fd;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return -1;
+}
+
+int main() {
+  TempDir Dir;
+  writeFile(Dir.path("uaf.ll"), UseAfterFree);
+
+  AnalysisDaemon::Options Opts;
+  Opts.Address = "unix:" + Dir.path("daemon.sock");
+  Opts.CachePath = Dir.path("analyzer.cache");
+  AnalysisDaemon Daemon(Opts);
+  bool Served = false;
+  std::thread Server([&Daemon, &Served] { Served = Daemon.run(); });
+
+  // A client that connects and never sends anything must not keep the
+  // daemon from shutting down.
+  int Idle = waitForDaemon(Opts.Address);
+  CHECK(Idle >= 0);
+
+  // The second request is answered from the cache with the same report.
+  for (int Round = 0; Round < 2; ++Round) {
+    std::string Report, Error;
+    CHECK(requestAnalysis(Opts.Address, Dir.path("uaf.ll"), Report, Error));
+    std::vector<BugReport> Reports;
+    CHECK(readResults(Report, Reports));
+    CHECK(Reports.size() == 1);
+    if (Reports.size() == 1) {
+      CHECK(Reports[0].RuleId == "use-after-free");
+    }
+  }
+  CHECK(sys::fs::exists(Opts.CachePath));
+
+  std::string Report, Error;
+  CHECK(!requestAnalysis(Opts.Address, Dir.path("missing.ll"), Report, Error));
+  CHECK(!Error.empty());
+
+  CHECK(requestShutdown(Opts.Address, Error));
+  Server.join();
+  CHECK(Served);
+  if (Idle >= 0) {
+    close(Idle);
+  }
+  return Failures != 0;
+}
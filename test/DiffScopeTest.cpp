@@ -0,0 +1,167 @@
+#include "Check.h"
+#include "DiffScope.h"
+#include "SimplePass.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include <algorithm>
+
+/// helper is on lines 3-5, make on 7-9 and main on 11-15 of src/app.c. main
+/// calls helper but not make.
+static const char *App = R"(
+declare i8* @malloc(i64)
+
+define void @helper(i8* %q) !dbg !10 {
+entry:
+  %a = getelementptr inbounds i8, i8* %q, i64 0, !dbg !11
+  store i8 1, i8* %a, !dbg !11
+  ret void, !dbg !12
+}
+
+define i8* @make() !dbg !20 {
+entry:
+  %call = call i8* @malloc(i64 10), !dbg !21
+  ret i8* %call, !dbg !22
+}
+
+define i32 @main() !dbg !30 {
+entry:
+  %p = alloca i8*, !dbg !31
+  %call = call i8* @malloc(i64 10), !dbg !32
+  store i8* %call, i8** %p, !dbg !32
+  %v = load i8*, i8** %p, !dbg !33
+  call void @helper(i8* %v), !dbg !33
+  ret i32 0, !dbg !34
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2, !3}
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "test", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "src/app.c", directory: "/work/repo")
+!2 = !{i32 2, !"Debug Info Version", i32 3}
+!3 = !{i32 7, !"Dwarf Version", i32 4}
+!4 = !DISubroutineType(types: !{})
+!10 = distinct !DISubprogram(name: "helper", scope: !1, file: !1, line: 3, type: !4, scopeLine: 3, unit: !0)
+!11 = !DILocation(line: 4, column: 3, scope: !10)
+!12 = !DILocation(line: 5, column: 1, scope: !10)
+!20 = distinct !DISubprogram(name: "make", scope: !1, file: !1, line: 7, type: !4, scopeLine: 7, unit: !0)
+!21 = !DILocation(line: 8, column: 3, scope: !20)
+!22 = !DILocation(line: 9, column: 1, scope: !20)
+!30 = distinct !DISubprogram(name: "main", scope: !1, file: !1, line: 11, type: !4, scopeLine: 11, unit: !0)
+!31 = !DILocation(line: 12, column: 3, scope: !30)
+!32 = !DILocation(line: 13, column: 3, scope: !30)
+!33 = !DILocation(line: 14, column: 3, scope: !30)
+!34 = !DILocation(line: 15, column: 1, scope: !30)
+)";
+
+static std::unique_ptr<Module> parseApp(LLVMContext &Context) {
+  SMDiagnostic Diag;
+  std::unique_ptr<Module> M = parseIR(MemoryBufferRef(App, "app.ll"), Diag, Context);
+  CHECK(M);
+  return M;
+}
+
+/// Load Text as a diff and return the names of the functions of App it changes.
+static std::string changedFunctions(StringRef Text) {
+  TempDir Dir;
+  writeFile(Dir.path("patch"), Text);
+  DiffScope Scope;
+  std::string Error;
+  CHECK(Scope.load(Dir.path("patch"), Error));
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseApp(Context);
+  std::string Names;
+  for (Function &F : *M) {
+    if (!F.isDeclaration() && Scope.isChanged(F)) {
+      Names += (Names.empty() ? "" : " ") + F.getName().str();
+    }
+  }
+  return Names;
+}
+
+static void testUnifiedDiff() {
+  CHECK(changedFunctions("diff --git a/src/app.c b/src/app.c\n"
+                         "--- a/src/app.c\n"
+                         "+++ b/src/app.c\n"
+                         "@@ -4 +4 @@ void helper(char *q) {\n"
+                         "-  q[0] = 0;\n"
+                         "+  q[0] = 1;\n") == "helper");
+  // A deletion-only hunk marks the line before it, here inside make.
+  CHECK(changedFunctions("--- a/src/app.c\n"
+                         "+++ b/src/app.c\n"
+                         "@@ -9,2 +8,0 @@\n") == "make");
+  // Lines between the functions and other files change nothing.
+  CHECK(changedFunctions("--- a/src/app.c\n"
+                         "+++ b/src/app.c\n"
+                         "@@ -6 +6 @@\n"
+                         "--- a/src/other.c\n"
+                         "+++ b/src/other.c\n"
+                         "@@ -1,20 +1,20 @@\n")
+            .empty());
+  // A deleted file has no new side.
+  CHECK(changedFunctions("--- a/src/app.c\n"
+                         "+++ /dev/null\n"
+                         "@@ -1,20 +0,0 @@\n")
+            .empty());
+}
+
+static void testLineList() {
+  CHECK(changedFunctions("# comment\napp.c:13\n") == "main");
+  CHECK(changedFunctions("src/app.c:3-8\n") == "helper make");
+  // Only whole path components match.
+  CHECK(changedFunctions("pp.c:13\n").empty());
+}
+
+static void testMalformed() {
+  TempDir Dir;
+  for (const char *Text : {"+++ b/a.c\n@@ -1 +x @@\n", "a.c\n", "a.c:5-3\n"}) {
+    writeFile(Dir.path("patch"), Text);
+    DiffScope Scope;
+    std::string Error;
+    CHECK(!Scope.load(Dir.path("patch"), Error));
+    CHECK(!Error.empty());
+  }
+}
+
+/// A diff-scoped analysis of a lazily read module reads only the bodies of
+/// the functions main reaches.
+static void testLazyModule() {
+  TempDir Dir;
+  {
+    LLVMContext Context;
+    std::unique_ptr<Module> M = parseApp(Context);
+    std::error_code EC;
+    raw_fd_ostream OS(Dir.path("app.bc"), EC);
+    WriteBitcodeToFile(*M, OS);
+  }
+  writeFile(Dir.path("patch"), "app.c:4\n");
+  DiffScope Scope;
+  std::string Error;
+  CHECK(Scope.load(Dir.path("patch"), Error));
+
+  LLVMContext Context;
+  SMDiagnostic Diag;
+  std::unique_ptr<Module> M = getLazyIRFileModule(Dir.path("app.bc"), Diag, Context);
+  CHECK(M);
+  if (!M) {
+    return;
+  }
+  std::vector<std::string> Asked;
+  AnalyzerOptions Options;
+  Options.isChanged = [&Scope, &Asked](const Function &F) {
+    Asked.push_back(F.getName().str());
+    return Scope.isChanged(F);
+  };
+  SimplePass().findBugs(*M, Options);
+  CHECK(M->getFunction("make")->isMaterializable());
+  CHECK(std::find(Asked.begin(), Asked.end(), "make") == Asked.end());
+  CHECK(std::find(Asked.begin(), Asked.end(), "helper") != Asked.end());
+}
+
+int main() {
+  testUnifiedDiff();
+  testLineList();
+  testMalformed();
+  testLazyModule();
+  return Failures != 0;
+}
@@ -0,0 +1,142 @@
+#include "Check.h"
+#include "Farm.h"
+#include "FindingsLog.h"
+#include <algorithm>
+#include <sys/socket.h>
+#include <thread>
+
+static const char *UseAfterFree = R"(
+declare noalias i8* @malloc(i64)
+declare void @free(i8*)
+
+define i32 @main() {
+entry:
+  %p = alloca i32*, align 8
+  %call = call noalias i8* @malloc(i64 4)
+  %0 = bitcast i8* %call to i32*
+  store i32* %0, i32** %p, align 8
+  %1 = load i32*, i32** %p, align 8
+  %2 = bitcast i32* %1 to i8*
+  call void @free(i8* %2)
+  %3 = load i32*, i32** %p, align 8
+  store i32 5, i32* %3, align 4
+  ret i32 0
+}
+)";
+
+static const char *Clean = R"(
+define i32 @main() {
+entry:
+  ret i32 0
+}
+)";
+
+static void testFraming() {
+  int Fds[2];
+  CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, Fds) == 0);
+  MessageStream Sender(Fds[0]);
+  MessageStream Receiver(Fds[1]);
+
+  // Payloads may hold anything, including line breaks and NUL bytes.
+  std::string Payload("line one\nline two\0tail", 22);
+  CHECK(Sender.send({"RESULT", "7", "ok"}, Payload));
+  Message Msg;
+  CHECK(Receiver.receive(Msg));
+  CHECK(Msg.getCommand() == "RESULT");
+  CHECK(Msg.Args == std::vector<std::string>({"RESULT", "7", "ok"}));
+  CHECK(Msg.Payload == Payload);
+
+  // Messages sent back to back arrive separately.
+  CHECK(Sender.send({"NEXT"}));
+  CHECK(Sender.send({"HEARTBEAT"}));
+  std::vector<Message> Received;
+  while (Received.size() < 2 && Receiver.poll(Received)) {
+  }
+  CHECK(Received.size() == 2);
+  if (Received.size() == 2) {
+    CHECK(Received[0].getCommand() == "NEXT" && Received[0].Payload.empty());
+    CHECK(Received[1].getCommand() == "HEARTBEAT");
+  }
+
+  Sender.close();
+  CHECK(!Receiver.receive(Msg));
+}
+
+static int waitForCoordinator(StringRef Address) {
+  std::string Error;
+  for (int Attempt = 0; Attempt < 100; ++Attempt) {
+    int Fd = connectTo(Address, Error);
+    if (Fd >= 0) {
+      return Fd;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return -1;
+}
+
+static void testCoordinator() {
+  TempDir Dir;
+  std::vector<std::string> Inputs = {Dir.path("uaf.ll"), Dir.path("clean.ll")};
+  writeFile(Inputs[0], UseAfterFree);
+  writeFile(Inputs[1], Clean);
+
+  Coordinator::Options Opts;
+  Opts.Address = "unix:" + Dir.path("farm.sock");
+  Opts.MergedOutput = Dir.path("merged.sarif");
+  Opts.FindingsLog = Dir.path("findings.log");
+  Opts.Analysis.prescreen = true;
+  Opts.LazyLoad = true;
+  int Failed = -1;
+  std::thread Server([&Inputs, &Opts, &Failed] { Failed = Coordinator(Inputs, Opts).run(); });
+
+  // A worker that takes the first job and goes away without an answer: the
+  // job carries the coordinator's options and is handed out again.
+  {
+    int Fd = waitForCoordinator(Opts.Address);
+    CHECK(Fd >= 0);
+    MessageStream Stream(Fd);
+    Message Job;
+    CHECK(Stream.send({FarmCommand::Next}));
+    CHECK(Stream.receive(Job));
+    CHECK(Job.getCommand() == FarmCommand::Job);
+    CHECK(Job.Payload == Inputs[0]);
+    CHECK(std::count(Job.Args.begin(), Job.Args.end(), "prescreen=1") == 1);
+    CHECK(std::count(Job.Args.begin(), Job.Args.end(), "lazy=1") == 1);
+    CHECK(std::count(Job.Args.begin(), Job.Args.end(), "slice=0") == 1);
+  }
+
+  FarmWorker::Options WorkerOpts;
+  WorkerOpts.Address = Opts.Address;
+  CHECK(FarmWorker(WorkerOpts).run() == 2);
+  Server.join();
+  CHECK(Failed == 0);
+
+  auto Merged = MemoryBuffer::getFile(Opts.MergedOutput);
+  CHECK(Merged);
+  std::vector<BugReport> Reports;
+  if (Merged) {
+    CHECK(readResults((*Merged)->getBuffer(), Reports));
+  }
+  CHECK(Reports.size() == 1);
+  if (Reports.size() == 1) {
+    CHECK(Reports[0].RuleId == "use-after-free");
+  }
+
+  std::string Error;
+  auto Log = FindingsLogReader::open(Opts.FindingsLog, Error);
+  CHECK(Log);
+  if (Log) {
+    LoggedFinding Finding;
+    CHECK(Log->next(Finding));
+    CHECK(Finding.Input == Inputs[0]);
+    CHECK(Finding.RuleId == "use-after-free");
+    CHECK(!Log->next(Finding));
+    CHECK(Log->getError().empty());
+  }
+}
+
+int main() {
+  testFraming();
+  testCoordinator();
+  return Failures != 0;
+}
@@ -0,0 +1,119 @@
+#include "Check.h"
+#include "FindingsLog.h"
+
+static BugReport makeReport(StringRef RuleId, int RuleIndex, unsigned Line) {
+  return BugReport({{"file:///src/a.c", Line}, {"file:///src/b.c", Line + 1}}, RuleId, RuleIndex);
+}
+
+static std::vector<LoggedFinding> readAll(const std::string &Path, std::string &Error,
+                                          std::unique_ptr<FindingsLogReader> &Reader) {
+  std::vector<LoggedFinding> Findings;
+  Reader = FindingsLogReader::open(Path, Error);
+  if (!Reader) {
+    return Findings;
+  }
+  LoggedFinding Finding;
+  while (Reader->next(Finding)) {
+    Findings.push_back(Finding);
+  }
+  Error = Reader->getError();
+  return Findings;
+}
+
+static void testRoundTrip() {
+  TempDir Dir;
+  std::string Error;
+  {
+    auto Writer = FindingsLogWriter::create(Dir.path("one.log"), Error);
+    CHECK(Writer);
+    Writer->add("a.bc", makeReport("memory-leak", 1, 10));
+    Writer->add("b.bc", makeReport("use-after-free", 2, 20));
+    // Strings already defined in the segment are reused.
+    Writer->add("a.bc", makeReport("memory-leak", 1, 30));
+    Writer->flush();
+  }
+
+  std::unique_ptr<FindingsLogReader> Reader;
+  std::vector<LoggedFinding> Findings = readAll(Dir.path("one.log"), Error, Reader);
+  CHECK(Error.empty());
+  CHECK(Findings.size() == 3);
+  if (Findings.size() == 3) {
+    CHECK(Findings[0].Input == "a.bc");
+    CHECK(Findings[0].RuleId == "memory-leak");
+    CHECK(Findings[0].RuleIndex == 1);
+    CHECK(Findings[0].Trace.size() == 2);
+    CHECK(Findings[0].Trace[1].first == "file:///src/b.c");
+    CHECK(Findings[0].Trace[1].second == 11);
+    CHECK(Findings[1].Input == "b.bc");
+    CHECK(Findings[1].RuleId == "use-after-free");
+    CHECK(Findings[2].Trace[0].second == 30);
+
+    BugReport Report = Findings[1].toBugReport();
+    CHECK(Report.RuleId == "use-after-free");
+    CHECK(Report.RuleIndex == 2);
+    CHECK(Report.Trace.size() == 2 && Report.Trace[0].second == 20);
+  }
+}
+
+static void testConcatenatedSegments() {
+  TempDir Dir;
+  std::string Error;
+  for (const char *Name : {"one.log", "two.log"}) {
+    auto Writer = FindingsLogWriter::create(Dir.path(Name), Error);
+    CHECK(Writer);
+    Writer->add(Name, makeReport("buffer-overflow", 0, 5));
+    Writer->flush();
+  }
+  auto One = MemoryBuffer::getFile(Dir.path("one.log"));
+  auto Two = MemoryBuffer::getFile(Dir.path("two.log"));
+  CHECK(One && Two);
+  if (!One || !Two) {
+    return;
+  }
+  writeFile(Dir.path("both.log"), ((*One)->getBuffer() + (*Two)->getBuffer()).str());
+
+  std::unique_ptr<FindingsLogReader> Reader;
+  std::vector<LoggedFinding> Findings = readAll(Dir.path("both.log"), Error, Reader);
+  CHECK(Error.empty());
+  CHECK(Findings.size() == 2);
+  if (Findings.size() == 2) {
+    CHECK(Findings[0].Input == "one.log");
+    CHECK(Findings[1].Input == "two.log");
+    CHECK(Findings[0] < Findings[1]);
+    CHECK(!(Findings[0] == Findings[1]));
+  }
+}
+
+static void testMalformed() {
+  TempDir Dir;
+  std::string Error;
+  {
+    auto Writer = FindingsLogWriter::create(Dir.path("full.log"), Error);
+    Writer->add("a.bc", makeReport("memory-leak", 1, 10));
+    Writer->flush();
+  }
+  auto Full = MemoryBuffer::getFile(Dir.path("full.log"));
+  CHECK(Full);
+  if (!Full) {
+    return;
+  }
+  // Cut inside the finding record: the reader stops with an error.
+  StringRef Data = (*Full)->getBuffer();
+  writeFile(Dir.path("cut.log"), Data.drop_back(3));
+  std::unique_ptr<FindingsLogReader> Reader;
+  std::vector<LoggedFinding> Findings = readAll(Dir.path("cut.log"), Error, Reader);
+  CHECK(Findings.empty());
+  CHECK(!Error.empty());
+
+  writeFile(Dir.path("text.log"), "not a log");
+  Error.clear();
+  CHECK(!FindingsLogReader::open(Dir.path("text.log"), Error));
+  CHECK(!Error.empty());
+}
+
+int main() {
+  testRoundTrip();
+  testConcatenatedSegments();
+  testMalformed();
+  return Failures != 0;
+}
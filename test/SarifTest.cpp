@@ -0,0 +1,112 @@
+#include "Check.h"
+#include "Sarif.h"
+#include "llvm/Support/JSON.h"
+
+static std::vector<BugReport> sampleReports() {
+  return {
+      BugReport({{"file:///src/a%20b.c", 3}, {"file:///src/c.c", 17}}, "memory-leak", 1),
+      BugReport({{"file:///src/\"quoted\".c", 9}}, "use-after-free", 2),
+  };
+}
+
+static bool sameReports(const std::vector<BugReport> &LHS, const std::vector<BugReport> &RHS) {
+  if (LHS.size() != RHS.size()) {
+    return false;
+  }
+  for (size_t I = 0; I < LHS.size(); ++I) {
+    if (LHS[I].RuleId != RHS[I].RuleId || LHS[I].RuleIndex != RHS[I].RuleIndex ||
+        LHS[I].Trace != RHS[I].Trace) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::string writeLog(const std::vector<BugReport> &Reports, bool Compact,
+                            ArrayRef<std::string> Notifications = {}) {
+  std::string Text;
+  raw_string_ostream OS(Text);
+  {
+    SarifWriter Writer(OS, Compact);
+    for (const BugReport &Report : Reports) {
+      Writer.addResult(Report);
+    }
+    for (const std::string &Notification : Notifications) {
+      Writer.addNotification(Notification);
+    }
+  }
+  return OS.str();
+}
+
+static void testRoundTrip() {
+  for (bool Compact : {false, true}) {
+    std::string Text = writeLog(sampleReports(), Compact);
+    CHECK(Compact == (StringRef(Text).rtrim().find('\n') == StringRef::npos));
+    std::vector<BugReport> Reports;
+    CHECK(readResults(Text, Reports));
+    CHECK(sameReports(Reports, sampleReports()));
+  }
+
+  // An empty log is still a valid one.
+  std::vector<BugReport> Reports;
+  CHECK(readResults(writeLog({}, true), Reports));
+  CHECK(Reports.empty());
+}
+
+static void testNotifications() {
+  std::string Text = writeLog(sampleReports(), true, {"graphs: built 1 of 2 functions"});
+  Expected<json::Value> Log = json::parse(Text);
+  CHECK(bool(Log));
+  if (!Log) {
+    consumeError(Log.takeError());
+    return;
+  }
+  const json::Object *Run = Log->getAsObject()->getArray("runs")->front().getAsObject();
+  const json::Array *Invocations = Run->getArray("invocations");
+  CHECK(Invocations && Invocations->size() == 1);
+  if (Invocations && Invocations->size() == 1) {
+    const json::Array *Notes = (*Invocations)[0].getAsObject()->getArray("toolExecutionNotifications");
+    CHECK(Notes && Notes->size() == 1);
+    if (Notes && Notes->size() == 1) {
+      Optional<StringRef> Message = (*Notes)[0].getAsObject()->getObject("message")->getString("text");
+      CHECK(Message && *Message == "graphs: built 1 of 2 functions");
+    }
+  }
+  std::vector<BugReport> Reports;
+  CHECK(readResults(Text, Reports));
+  CHECK(sameReports(Reports, sampleReports()));
+}
+
+static void testAddResults() {
+  std::string Part = writeLog(sampleReports(), true);
+  std::string Text;
+  raw_string_ostream OS(Text);
+  {
+    SarifWriter Writer(OS, true);
+    CHECK(Writer.addResults(Part));
+    CHECK(Writer.addResults(Part));
+    CHECK(!Writer.addResults("{not json"));
+  }
+  std::vector<BugReport> Reports;
+  CHECK(readResults(OS.str(), Reports));
+  std::vector<BugReport> Twice = sampleReports();
+  for (const BugReport &Report : sampleReports()) {
+    Twice.push_back(Report);
+  }
+  CHECK(sameReports(Reports, Twice));
+}
+
+static void testMalformed() {
+  std::vector<BugReport> Reports;
+  CHECK(!readResults("", Reports));
+  CHECK(!readResults("{\"runs\": 3}", Reports));
+  CHECK(!readResults("{\"runs\": [{\"results\": [17]}]}", Reports));
+}
+
+int main() {
+  testRoundTrip();
+  testNotifications();
+  testAddResults();
+  testMalformed();
+  return Failures != 0;
+}